@@ -0,0 +1,1275 @@
+// Headless benchmarks, builds synthetic trees and times Update, Layout and Draw
+// no window is opened, drawing goes into a DrawList and a RecordingBackend
+//
+// usage: my_guilib_bench [--frames N] [--csv] [--trace file.json] [name filter]
+// --trace needs a GUILIB_PROFILE build, the timings then include the profiler
+// prints one JSON object per benchmark (or name,metric,value lines with --csv)
+// so the output of two runs can be diffed, exits with 1 when a check failed
+#include "guilib.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+// ========================================================
+// Allocation counting
+//
+static long allocationCount = 0;
+
+// none of them are inlined, GCC would otherwise pair the malloc() in one
+// with the free() in the other and warn (-Wmismatched-new-delete)
+[[gnu::noinline]] void* operator new(size_t size) {
+    allocationCount++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void* operator new[](size_t size) {
+    allocationCount++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void* p) noexcept {std::free(p);}
+[[gnu::noinline]] void operator delete[](void* p) noexcept {std::free(p);}
+[[gnu::noinline]] void operator delete(void* p, size_t) noexcept {std::free(p);}
+[[gnu::noinline]] void operator delete[](void* p, size_t) noexcept {std::free(p);}
+
+// ========================================================
+// Output
+//
+using Clock = std::chrono::steady_clock;
+
+static double nsBetween(Clock::time_point a, Clock::time_point b) {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count();
+}
+
+// One line of results, printed as soon as a benchmark is done
+struct Result {
+    std::string name;
+    std::vector<std::pair<std::string, double>> values;
+
+    Result& add(const char* key, double value) {
+        values.emplace_back(key, value);
+        return *this;
+    }
+
+    // printed as 1 or 0, a 0 makes the run fail
+    Result& check(const char* key, bool ok) {
+        if (!ok) failed.push_back(key);
+        return add(key, ok ? 1 : 0);
+    }
+
+    std::vector<std::string> failed;
+};
+
+static bool csvOutput = false;
+static int failedChecks = 0;
+
+static void report(const Result& result) {
+    if (csvOutput) {
+        for (const auto& v : result.values)
+            std::printf("%s,%s,%.1f\n", result.name.c_str(), v.first.c_str(), v.second);
+    }
+    else {
+        std::printf("{\"bench\": \"%s\"", result.name.c_str());
+        for (const auto& v : result.values)
+            std::printf(", \"%s\": %.1f", v.first.c_str(), v.second);
+        std::printf("}\n");
+    }
+    std::fflush(stdout);
+
+    for (const std::string& key : result.failed) {
+        std::fprintf(stderr, "FAILED: %s %s\n", result.name.c_str(), key.c_str());
+        failedChecks++;
+    }
+}
+
+// ========================================================
+// Scenes
+//
+
+// Monospace font made in memory, raylib only has a font once a window is open
+// the texture id is never drawn, MeasureTextEx just wants it to be set
+static Font makeBenchFont() {
+    // made once, every font returned points into them
+    static std::vector<Rectangle> recs;
+    static std::vector<GlyphInfo> glyphs;
+    if (recs.empty()) {
+        for (int codepoint = 32; codepoint < 127; codepoint++) {
+            recs.push_back(Rectangle{(float)(codepoint - 32) * 8, 0, 8, 10});
+            glyphs.push_back(GlyphInfo{codepoint, 0, 0, 8, Image{}});
+        }
+    }
+    Font font = Font{};
+    font.baseSize = 10;
+    font.glyphCount = (int)glyphs.size();
+    font.texture.id = 1;
+    font.recs = recs.data();
+    font.glyphs = glyphs.data();
+    return font;
+}
+
+static std::string makeText(const char* prefix, int i, int length) {
+    std::string text = prefix + std::to_string(i);
+    while ((int)text.size() < length) text += " lorem ipsum";
+    if (length > 0) text.resize(length);
+    return text;
+}
+
+// A grid of buttons in one panel
+static std::unique_ptr<Panel> makeButtonGrid(int count, int textLength, std::vector<Button*>* buttons = nullptr) {
+    int columns = 100;
+    auto root = std::make_unique<Panel>();
+    root -> setSize(columns * 120, (count / columns + 1) * 40);
+    for (int i = 0; i < count; i++) {
+        auto btn = std::make_unique<Button>(makeText("Button ", i, textLength));
+        btn -> setPosition((i % columns) * 120, (i / columns) * 40);
+        if (buttons) buttons->push_back(btn.get());
+        root -> addChild(std::move(btn));
+    }
+    return root;
+}
+
+// Panels fanOut wide and depth deep, every leaf has a label
+static void fillTree(Panel& panel, int depth, int fanOut, int& count) {
+    for (int i = 0; i < fanOut; i++) {
+        if (depth <= 1) {
+            auto lbl = std::make_unique<Label>(makeText("Leaf ", count, 0), 16);
+            lbl -> setPosition(4, 4 + i * 20);
+            panel.addChild(std::move(lbl));
+        }
+        else {
+            auto child = std::make_unique<Panel>();
+            child -> setPosition(4 + i * 8, 4 + i * 8);
+            child -> setSize(400, 400);
+            fillTree(*child, depth - 1, fanOut, count);
+            panel.addChild(std::move(child));
+        }
+        count++;
+    }
+}
+
+// Columns of buttons in FlexPanels
+static std::unique_ptr<Panel> makeFlexColumns(int count, std::vector<Button*>* buttons) {
+    int perColumn = 50;
+    auto root = std::make_unique<FlexPanel>(FlexDirection::Row);
+    root -> setGap(4);
+    for (int i = 0; i < count; i += perColumn) {
+        auto column = std::make_unique<FlexPanel>(FlexDirection::Column);
+        column -> setPadding(4);
+        column -> setGap(2);
+        column -> setAlign(FlexAlign::Stretch);
+        for (int j = i; j < std::min(count, i + perColumn); j++) {
+            auto btn = std::make_unique<Button>(makeText("Item ", j, 0));
+            btn -> setMargin(1);
+            if (buttons) buttons->push_back(btn.get());
+            column -> addChild(std::move(btn));
+        }
+        root -> addChild(std::move(column));
+    }
+    return root;
+}
+
+// ========================================================
+// Benchmarks
+//
+static int frameCount = 100;
+
+// Runs frames on the tree, mutate is timed as part of Update (it is what input would do)
+// the first frame measures and lays out everything, it is reported on its own
+static void runFrames(const std::string& name, Control& root, Result result,
+                      const std::function<void(int)>& mutate = nullptr) {
+    UiContext ui;
+    root.setContext(&ui);
+    DrawList list;
+    RecordingBackend backend;
+
+    double firstNs = 0, updateNs = 0, layoutNs = 0, drawNs = 0;
+    long allocations = 0, drawCalls = 0, measurements = 0, layouts = 0, drawnNodes = 0;
+    for (int frame = 0; frame <= frameCount; frame++) {
+        uiStats.reset();
+        ui.damage.clear();
+        long allocStart = allocationCount;
+
+        Clock::time_point t0 = Clock::now();
+        {
+            GUI_PROFILE_PHASE("Update", UpdatePhase);
+            if (mutate) mutate(frame);
+            root.Update();
+        }
+        Clock::time_point t1 = Clock::now();
+        {
+            GUI_PROFILE_PHASE("Layout", LayoutPhase);
+            root.Layout();
+        }
+        Clock::time_point t2 = Clock::now();
+        {
+            GUI_PROFILE_PHASE("Draw", DrawPhase);
+            list.clear();
+            root.Draw(list);
+            backend.reset();
+            backend.submit(list);
+        }
+        Clock::time_point t3 = Clock::now();
+        GUI_PROFILE_END_FRAME();
+
+        if (frame == 0) {
+            firstNs = nsBetween(t0, t3);
+            continue;
+        }
+        updateNs += nsBetween(t0, t1);
+        layoutNs += nsBetween(t1, t2);
+        drawNs += nsBetween(t2, t3);
+        allocations += allocationCount - allocStart;
+        drawCalls += uiStats.drawCalls;
+        measurements += uiStats.textMeasurements;
+        layouts += uiStats.layoutPasses;
+        drawnNodes += uiStats.drawnNodes;
+    }
+    root.setContext(nullptr);
+
+    double frames = frameCount;
+    result.name = name;
+    result.add("nodes", (double)root.getSubtreeCount())
+          .add("frames", frames)
+          .add("first_frame_ns", firstNs)
+          .add("update_ns", updateNs / frames)
+          .add("layout_ns", layoutNs / frames)
+          .add("draw_ns", drawNs / frames)
+          .add("frame_ns", (updateNs + layoutNs + drawNs) / frames)
+          .add("allocs_per_frame", allocations / frames)
+          .add("draw_calls", drawCalls / frames)
+          .add("drawn_nodes", drawnNodes / frames)
+          .add("text_measurements", measurements / frames)
+          .add("layout_passes", layouts / frames);
+    report(result);
+}
+
+static void benchButtons(int count) {
+    auto root = makeButtonGrid(count, 0);
+    runFrames("buttons", *root, Result{}.add("n", count));
+}
+
+// one percent of the buttons get a new text every frame
+static void benchButtonsChanging(int count) {
+    std::vector<Button*> buttons;
+    auto root = makeButtonGrid(count, 0, &buttons);
+    int step = 100;
+    runFrames("buttons_changing", *root, Result{}.add("n", count), [&](int frame) {
+        for (size_t i = frame % step; i < buttons.size(); i += step)
+            buttons[i] -> setText(makeText("Changed ", frame, 0));
+    });
+}
+
+static void benchTree(int depth, int fanOut) {
+    auto root = std::make_unique<Panel>();
+    root -> setSize(1920, 1080);
+    int count = 0;
+    fillTree(*root, depth, fanOut, count);
+    runFrames("tree", *root, Result{}.add("depth", depth).add("fan_out", fanOut));
+}
+
+// World positions are cached: a full pass over a deep tree computes each one
+// once, a second pass none, and a move only redoes the subtree that moved
+static void benchTransforms(int depth, int leaves) {
+    auto root = std::make_unique<Panel>();
+    root -> setSize(1920, 1080);
+    std::vector<Control*> nodes = {root.get()};
+    Panel* level = root.get();
+    Panel* middle = nullptr;
+    for (int d = 1; d < depth; d++) {
+        for (int i = 0; i < leaves / depth; i++) {
+            auto leaf = std::make_unique<Label>(makeText("Leaf ", i, 0), 16);
+            leaf -> setPosition(i % 40 * 40, i / 40 * 4);
+            nodes.push_back(leaf.get());
+            level -> addChild(std::move(leaf));
+        }
+        auto child = std::make_unique<Panel>();
+        child -> setPosition(2, 2);
+        child -> setSize(1900, 1060);
+        Panel* next = child.get();
+        nodes.push_back(next);
+        level -> addChild(std::move(child));
+        level = next;
+        if (d == depth / 2) middle = next;
+    }
+    for (int i = 0; i < leaves - leaves / depth * (depth - 1); i++) {
+        auto leaf = std::make_unique<Label>(makeText("Leaf ", i, 0), 16);
+        nodes.push_back(leaf.get());
+        level -> addChild(std::move(leaf));
+    }
+    root -> Layout();
+
+    // asks every node for its world position and draws the tree
+    DrawList list;
+    auto fullPass = [&]() {
+        uiStats.reset();
+        for (Control* c : nodes) c -> getWorldPosition();
+        list.clear();
+        root -> Draw(list);
+        return uiStats.worldTransformUpdates;
+    };
+
+    long first = fullPass();
+    long repeat = fullPass();
+    root -> setPosition(1, 1);
+    long afterRootMove = fullPass();
+    middle -> setPosition(3, 3);
+    long afterMiddleMove = fullPass();
+    long middleSubtree = (long)middle->getSubtreeCount();
+
+    long count = (long)nodes.size();
+    report(Result{"transforms"}.add("depth", depth)
+                               .add("nodes", (double)count)
+                               .add("first_pass_updates", (double)first)
+                               .add("repeat_pass_updates", (double)repeat)
+                               .add("root_move_updates", (double)afterRootMove)
+                               .add("middle_move_updates", (double)afterMiddleMove)
+                               .check("first_pass_once_per_node", first <= count)
+                               .check("repeat_pass_none", repeat == 0)
+                               .check("root_move_once_per_node", afterRootMove <= count)
+                               .check("middle_move_subtree_only", afterMiddleMove <= middleSubtree));
+}
+
+static void benchLongLabels(int count, int textLength) {
+    auto root = makeButtonGrid(count, textLength);
+    runFrames("long_labels", *root, Result{}.add("n", count).add("text_length", textLength));
+}
+
+// one button per frame changes its text, only its column should be laid out again
+static void benchFlex(int count) {
+    std::vector<Button*> buttons;
+    auto root = makeFlexColumns(count, &buttons);
+    runFrames("flex", *root, Result{}.add("n", count), [&](int frame) {
+        buttons[(frame * 7919) % buttons.size()] -> setText(makeText("Resized ", frame, 0));
+    });
+}
+
+// Pointer moves over a grid of buttons, reported per hit test
+static void benchHitTest(int count, int queries) {
+    auto root = makeButtonGrid(count, 0);
+    Rectangle area = Rectangle{0, 0, root->getSize().x, root->getSize().y};
+    InputDispatcher input(area);
+    UiContext ui;
+    ui.input = &input;
+    root -> setContext(&ui);
+    root -> Layout();
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> xs(0, area.width), ys(0, area.height);
+    std::vector<Vector2> points(queries);
+    for (Vector2& p : points) p = Vector2{xs(random), ys(random)};
+
+    input.hitTest(points[0]); // picks up the first bounds
+    long allocStart = allocationCount;
+    Clock::time_point t0 = Clock::now();
+    int hits = 0;
+    for (const Vector2& p : points) {
+        input.handlePointer(p, false, false);
+        if (input.getHovered()) hits++;
+    }
+    Clock::time_point t1 = Clock::now();
+    long allocations = allocationCount - allocStart;
+    input.handlePointer(Vector2{-1, -1}, false, false);
+    root -> setContext(nullptr);
+
+    report(Result{"hit_test"}.add("n", count)
+                             .add("queries", queries)
+                             .add("hits", hits)
+                             .add("query_ns", nsBetween(t0, t1) / queries)
+                             .add("allocs_per_query", (double)allocations / queries));
+}
+
+// Creating and tearing down rows on the heap and in a ControlPool
+static void benchPool(int count, int rounds) {
+    std::vector<ControlPtr> rows;
+    rows.reserve(count);
+
+    long allocStart = allocationCount;
+    Clock::time_point t0 = Clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < count; i++) rows.push_back(std::make_unique<Panel>());
+        rows.clear();
+    }
+    Clock::time_point t1 = Clock::now();
+    long heapAllocations = allocationCount - allocStart;
+
+    ControlPool pool;
+    allocStart = allocationCount;
+    Clock::time_point t2 = Clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < count; i++) rows.push_back(pool.create<Panel>());
+        rows.clear();
+    }
+    Clock::time_point t3 = Clock::now();
+    long poolAllocations = allocationCount - allocStart;
+
+    double created = (double)count * rounds;
+    report(Result{"pool_vs_heap"}.add("n", count)
+                                 .add("rounds", rounds)
+                                 .add("heap_ns_per_control", nsBetween(t0, t1) / created)
+                                 .add("heap_allocs", heapAllocations)
+                                 .add("pool_ns_per_control", nsBetween(t2, t3) / created)
+                                 .add("pool_allocs", poolAllocations)
+                                 .add("pool_blocks", pool.getBlockAllocations()));
+}
+
+// A ListView jumping around lists of 1k and of items rows, it should keep the
+// same few row controls and no per item memory for either. Then variable
+// heights, where the rows have to end up at the prefix sums of the heights
+static void benchListView(size_t items, int scrolls) {
+    char itemText[32];
+    auto bindItem = [&](Control& row, size_t index) {
+        std::snprintf(itemText, sizeof(itemText), "Item %zu", index);
+        static_cast<Label&>(row).setText(itemText);
+    };
+
+    Result fixed{"list_view"};
+    size_t rowsForFew = 0;
+    for (size_t count : {(size_t)1000, items}) {
+        UiContext ui;
+        ListView list;
+        list.setSize(800, 600);
+        list.setRowHeight(20);
+        list.setBindRow(bindItem);
+        list.setContext(&ui);
+
+        long allocStart = allocationCount;
+        list.setItemCount(count);
+        long setCountAllocations = allocationCount - allocStart;
+        list.Layout();
+
+        std::mt19937 random(7);
+        double maxScroll = count * 20.0 - 600.0;
+        allocStart = allocationCount;
+        Clock::time_point t0 = Clock::now();
+        for (int i = 0; i < scrolls; i++) {
+            if (i % 2 == 0) list.scrollTo(std::uniform_real_distribution<double>(0, maxScroll)(random), false);
+            else list.scrollTo(list.getScrollOffset() + 7, false);
+            list.Layout();
+        }
+        Clock::time_point t1 = Clock::now();
+        long scrollAllocations = allocationCount - allocStart;
+        list.setContext(nullptr);
+
+        if (count != items) {
+            rowsForFew = list.getChildCount();
+            continue;
+        }
+        fixed.add("n", (double)count)
+             .add("rows", (double)list.getChildCount())
+             .add("set_count_allocs", (double)setCountAllocations)
+             .add("scroll_ns", nsBetween(t0, t1) / scrolls)
+             .add("allocs_per_scroll", (double)scrollAllocations / scrolls)
+             .check("rows_same_as_1k", list.getChildCount() == rowsForFew)
+             .check("no_per_item_memory", setCountAllocations == 0);
+    }
+    report(fixed);
+
+    // variable heights, checked against a plain prefix sum
+    size_t variableItems = std::min(items, (size_t)1000000);
+    std::vector<float> heightOf(variableItems);
+    for (size_t i = 0; i < variableItems; i++) heightOf[i] = 14.0f + (float)((i * 7919) % 23);
+    std::vector<double> offsets(variableItems + 1, 0.0);
+    auto sumOffsets = [&]() {
+        for (size_t i = 0; i < variableItems; i++) offsets[i + 1] = offsets[i] + heightOf[i];
+    };
+    sumOffsets();
+
+    std::unordered_map<Control*, size_t> boundTo;
+    UiContext ui;
+    ListView list;
+    list.setSize(800, 600);
+    list.setBindRow([&](Control& row, size_t index) {
+        bindItem(row, index);
+        boundTo[&row] = index;
+    });
+    list.setRowHeights([&](size_t index) {return heightOf[index];});
+    list.setItemCount(variableItems);
+    list.setContext(&ui);
+    list.Layout();
+
+    // every row sits at its item's offset from the row of the first item, and they cover the view
+    auto rowsInPlace = [&](size_t first) {
+        bool found = false;
+        float firstY = 0;
+        for (Control* row = list.getFirstChild(); row; row = row->getNextSibling()) {
+            if (row->isVisible() && boundTo[row] == first) {
+                found = true;
+                firstY = row->getPosition().y;
+            }
+        }
+        if (!found) return false;
+        double bottom = 0;
+        for (Control* row = list.getFirstChild(); row; row = row->getNextSibling()) {
+            if (!row->isVisible()) continue;
+            size_t index = boundTo[row];
+            if (row->getPosition().y - firstY != (float)(offsets[index] - offsets[first])) return false;
+            bottom = std::max(bottom, offsets[index + 1] - offsets[first]);
+        }
+        return bottom >= std::min(600.0, offsets[variableItems] - offsets[first]);
+    };
+
+    // the index on its own, at random offsets and after heights changed
+    RowHeightIndex index;
+    index.setVariable(variableItems, [&](size_t i) {return heightOf[i];});
+    std::mt19937 random(11);
+    auto indexRight = [&]() {
+        for (int i = 0; i < 1000; i++) {
+            size_t item = random() % variableItems;
+            double at = offsets[item] + heightOf[item] * 0.5;
+            if (index.offsetOf(item) != offsets[item] || index.indexAt(at) != item) return false;
+        }
+        return index.totalHeight() == offsets[variableItems];
+    };
+    bool offsetsRight = indexRight();
+
+    double scrollNs = 0;
+    bool rowsRight = true;
+    for (int i = 0; i < scrolls; i++) {
+        size_t item = random() % variableItems;
+        if (i % 16 == 0) {
+            heightOf[item] = 14.0f + (float)(random() % 40);
+            index.setHeight(item, heightOf[item]);
+            list.updateRowHeight(item);
+            sumOffsets();
+        }
+        Clock::time_point t0 = Clock::now();
+        list.scrollToItem(item, false);
+        list.Layout();
+        scrollNs += nsBetween(t0, Clock::now());
+        // the last items can not scroll to the top
+        if (offsets[variableItems] - offsets[item] >= 600.0) rowsRight = rowsRight && rowsInPlace(item);
+    }
+    offsetsRight = offsetsRight && indexRight();
+    list.setContext(nullptr);
+
+    // one row for every 14 pixels of the view and one cut in half at both ends
+    report(Result{"list_view_variable"}.add("n", (double)variableItems)
+                                       .add("rows", (double)list.getChildCount())
+                                       .add("scroll_ns", scrollNs / scrolls)
+                                       .check("index_offsets", offsetsRight)
+                                       .check("rows_at_offsets", rowsRight)
+                                       .check("rows_bounded", list.getChildCount() <= 600 / 14 + 2));
+}
+
+// Measuring the text of a new tree with 1 to N threads, the layout that
+// follows has to come out the same every time
+static void benchParallelText(int count, int textLength) {
+    size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> threadCounts;
+    for (size_t t = 1; t < maxThreads; t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(maxThreads);
+
+    double serialNs = 0;
+    double serialChecksum = 0;
+    for (size_t threads : threadCounts) {
+        TextCache::shared().clear();
+        TextCache::shared().setBudget(256 * 1024 * 1024);
+        std::vector<Button*> buttons;
+        auto root = makeButtonGrid(count, textLength, &buttons);
+        ThreadPool pool(threads);
+        uiStats.reset();
+
+        Clock::time_point t0 = Clock::now();
+        root -> prepareLayout(&pool);
+        Clock::time_point t1 = Clock::now();
+        root -> Layout();
+        Clock::time_point t2 = Clock::now();
+
+        double checksum = 0;
+        for (size_t i = 0; i < buttons.size(); i++)
+            checksum += (buttons[i]->getSize().x * 3 + buttons[i]->getSize().y) * (double)(i % 97 + 1);
+        double totalNs = nsBetween(t0, t2);
+        if (threads == 1) {
+            serialNs = totalNs;
+            serialChecksum = checksum;
+        }
+
+        report(Result{"parallel_text"}.add("n", count)
+                                      .add("text_length", textLength)
+                                      .add("threads", (double)threads)
+                                      .add("prepare_ns", nsBetween(t0, t1))
+                                      .add("layout_ns", nsBetween(t1, t2))
+                                      .add("speedup", serialNs / totalNs)
+                                      .add("text_measurements", uiStats.textMeasurements)
+                                      .check("same_as_serial", checksum == serialChecksum));
+    }
+
+    // text changed on a live tree is left for prepareLayout() to measure on the pool,
+    // Layout() then damages where the new text is
+    {
+        std::vector<Button*> buttons;
+        auto root = makeButtonGrid(count, textLength, &buttons);
+        ThreadPool pool(maxThreads);
+        UiContext ui;
+        root -> prepareLayout(&pool);
+        root -> setContext(&ui);
+        root -> Layout();
+        ui.damage.clear();
+
+        uiStats.reset();
+        Clock::time_point t0 = Clock::now();
+        for (size_t i = 0; i < buttons.size(); i++)
+            buttons[i] -> setText(makeText("Changed ", (int)i, textLength + 8));
+        long setTextMeasurements = uiStats.textMeasurements;
+        Clock::time_point t1 = Clock::now();
+        root -> prepareLayout(&pool);
+        long prepareMeasurements = uiStats.textMeasurements - setTextMeasurements;
+        Clock::time_point t2 = Clock::now();
+        root -> Layout();
+        long layoutMeasurements = uiStats.textMeasurements - setTextMeasurements - prepareMeasurements;
+        Clock::time_point t3 = Clock::now();
+
+        bool newTextDamaged = true;
+        Rectangle damaged = ui.damage.getBounds();
+        for (Button* btn : buttons) {
+            Rectangle r = btn->getSubtreeBounds();
+            if (r.x < damaged.x || r.y < damaged.y || r.x + r.width > damaged.x + damaged.width
+                || r.y + r.height > damaged.y + damaged.height) newTextDamaged = false;
+        }
+
+        report(Result{"parallel_text_live"}.add("n", count)
+                                           .add("threads", (double)maxThreads)
+                                           .add("set_text_ns", nsBetween(t0, t1))
+                                           .add("prepare_ns", nsBetween(t1, t2))
+                                           .add("layout_ns", nsBetween(t2, t3))
+                                           .check("set_text_measures_nothing", setTextMeasurements == 0)
+                                           .check("prepare_measures_all", prepareMeasurements == (long)buttons.size())
+                                           .check("layout_measures_nothing", layoutMeasurements == 0)
+                                           .check("new_text_damaged", newTextDamaged));
+    }
+    TextCache::shared().clear();
+    TextCache::shared().setBudget(4 * 1024 * 1024);
+}
+
+// A TextArea over a log of about sizeMb megabytes, edits and scrolls at random
+// places and times each one with the layout that follows it
+static void benchTextArea(int sizeMb, int operations) {
+    std::string line;
+    std::string log;
+    log.reserve((size_t)sizeMb << 20);
+    for (int i = 0; log.size() < ((size_t)sizeMb << 20); i++) {
+        line = "2026-10-17 12:00:00 INFO request " + std::to_string(i) + " handled by worker " + std::to_string(i % 16);
+        line += (i % 10 == 0) ? makeText(" payload", i, 300) : std::string(" ok");
+        log += line;
+        log += '\n';
+    }
+    size_t bytes = log.size();
+
+    UiContext ui;
+    TextArea area;
+    area.setSize(800, 600);
+    area.setContext(&ui);
+    Clock::time_point t0 = Clock::now();
+    area.setText(std::move(log));
+    area.Layout();
+    Clock::time_point t1 = Clock::now();
+
+    // the max is mostly the machine doing something else, the 99th percentile is what to watch
+    std::mt19937 random(99);
+    std::vector<double> times;
+    times.reserve(operations);
+    struct Latency {
+        double mean, p99, max;
+    };
+    auto timeEach = [&](auto&& operation) {
+        times.clear();
+        double totalNs = 0;
+        for (int i = 0; i < operations; i++) {
+            Clock::time_point a = Clock::now();
+            operation(i);
+            area.Layout();
+            double ns = nsBetween(a, Clock::now());
+            totalNs += ns;
+            times.push_back(ns);
+        }
+        std::sort(times.begin(), times.end());
+        return Latency{totalNs / operations, times[(times.size() - 1) * 99 / 100], times.back()};
+    };
+
+    size_t cachedRuns = TextCache::shared().getEntryCount();
+    long allocStart = allocationCount;
+    Latency insert = timeEach([&](int i) {
+        size_t offset = random() % area.getSize();
+        area.scrollToLine(area.getLineCount() * (double)offset / area.getSize());
+        area.insert(offset, i % 3 == 0 ? "x\n" : "xy");
+    });
+    long insertAllocations = allocationCount - allocStart;
+    Latency scroll = timeEach([&](int) {area.scrollBy(37);});
+    Latency jump = timeEach([&](int) {area.scrollToLine(random() % area.getLineCount());});
+
+    // typing into what is shown shapes the edited line again and nothing else,
+    // scrolling by a row shapes the one row that comes into view
+    area.scrollToLine(1000);
+    area.Layout();
+    uiStats.reset();
+    area.insert(area.getLineStart(1005) + 3, "xy");
+    area.Layout();
+    bool editShapesLine = uiStats.textMeasurements == (long)area.getLineRows(1005);
+    uiStats.reset();
+    area.scrollBy(1);
+    area.Layout();
+    bool scrollShapesRow = uiStats.textMeasurements <= 1;
+    bool textCacheUntouched = TextCache::shared().getEntryCount() == cachedRuns;
+
+    // a long session, an edit should cost the same after many edits before it
+    // timed without layout, so it is the piece table and line index only
+    auto timeEdits = [&](long& allocations) {
+        long start = allocationCount;
+        Clock::time_point a = Clock::now();
+        for (int i = 0; i < operations; i++) area.insert(random() % area.getSize(), i % 3 == 0 ? "x\n" : "xy");
+        allocations = allocationCount - start;
+        return nsBetween(a, Clock::now()) / operations;
+    };
+    long editAllocations, lateEditAllocations;
+    double editNs = timeEdits(editAllocations);
+    for (int i = 0; i < 50000; i++) area.insert(random() % area.getSize(), "ab");
+    double lateEditNs = timeEdits(lateEditAllocations);
+
+    area.setContext(nullptr);
+    report(Result{"text_area"}.add("bytes", (double)bytes)
+                              .add("lines", (double)area.getLineCount())
+                              .add("load_ms", nsBetween(t0, t1) / 1e6)
+                              .add("insert_us", insert.mean / 1e3)
+                              .add("insert_p99_us", insert.p99 / 1e3)
+                              .add("insert_max_us", insert.max / 1e3)
+                              .add("allocs_per_insert", (double)insertAllocations / operations)
+                              .add("scroll_us", scroll.mean / 1e3)
+                              .add("scroll_p99_us", scroll.p99 / 1e3)
+                              .add("scroll_max_us", scroll.max / 1e3)
+                              .add("jump_us", jump.mean / 1e3)
+                              .add("jump_p99_us", jump.p99 / 1e3)
+                              .add("jump_max_us", jump.max / 1e3)
+                              .add("pieces", (double)area.getPieceCount())
+                              .add("edit_us", editNs / 1e3)
+                              .add("edit_after_50k_us", lateEditNs / 1e3)
+                              .add("allocs_per_edit", (double)(editAllocations + lateEditAllocations) / (2 * operations))
+                              .check("edit_shapes_edited_line", editShapesLine)
+                              .check("scroll_shapes_new_row", scrollShapesRow)
+                              .check("text_cache_untouched", textCacheUntouched));
+}
+
+// Every kind of control a ui file holds, with style overrides, flex settings,
+// hidden and clipping panels
+static std::unique_ptr<Panel> makeMixedScene() {
+    auto root = std::make_unique<Panel>();
+    root -> setSize(800, 600);
+    root -> setColor(RAYWHITE);
+    root -> setBorderThickness(6, 6);
+
+    auto label = std::make_unique<Label>("Hello label", 20);
+    label -> setTextColor(BLUE);
+    label -> setPosition(5, 7);
+    root -> addChild(std::move(label));
+
+    auto button = std::make_unique<Button>("Button");
+    button -> setTextColor(ORANGE);
+    button -> setFontSize(22);
+    button -> setPosition(40, 40);
+    button -> setBorderColor(RED);
+    root -> addChild(std::move(button));
+
+    auto row = std::make_unique<StackPanel>(FlexDirection::Row, 8);
+    row -> setPadding(6);
+    row -> setAlign(FlexAlign::Center);
+    row -> setColor(Color{200, 200, 200, 180});
+    for (const char* text : {"One", "Two", "Three"}) {
+        auto rowButton = std::make_unique<Button>(text);
+        rowButton -> setMargin(2);
+        rowButton -> setFlexGrow(1);
+        row -> addChild(std::move(rowButton));
+    }
+    root -> addChild(std::move(row));
+
+    auto column = std::make_unique<FlexPanel>(FlexDirection::Column);
+    column -> setJustify(FlexJustify::SpaceBetween);
+    column -> setAlign(FlexAlign::Stretch);
+    column -> setGap(3);
+    column -> setSize(200, 0);
+    column -> setClipChildren(false);
+    column -> addChild(std::make_unique<Label>("In a column", 12));
+    auto hidden = std::make_unique<Panel>();
+    hidden -> setVisibility(false);
+    hidden -> setHitTestable(true);
+    column -> addChild(std::move(hidden));
+    root -> addChild(std::move(column));
+    return root;
+}
+
+// Saves a tree, loads it back and saves that again, true when the bytes match
+static bool roundTrips(Control& root, std::string& data) {
+    UiFileWriter writer;
+    data.clear();
+    if (!writer.write(root, data)) return false;
+    std::vector<uint32_t> aligned(data.size() / 4 + 1);
+    std::memcpy(aligned.data(), data.data(), data.size());
+    ControlPtr loaded = UiFileReader().read(std::string_view((const char*)aligned.data(), data.size()));
+    std::string again;
+    return loaded && writer.write(*loaded, again) && again == data;
+}
+
+// Saving a grid of buttons as a ui file and loading it back, on the heap and
+// in a ControlPool; saving the loaded tree again has to give the same bytes
+static void benchUiFile(int count) {
+    auto root = makeButtonGrid(count, 0);
+    root -> Layout();
+
+    UiFileWriter writer;
+    std::string data;
+    Clock::time_point t0 = Clock::now();
+    writer.write(*root, data);
+    Clock::time_point t1 = Clock::now();
+
+    // like a mapped file, the records have to be aligned
+    std::vector<uint32_t> aligned(data.size() / 4 + 1);
+    std::memcpy(aligned.data(), data.data(), data.size());
+    std::string_view view((const char*)aligned.data(), data.size());
+
+    UiFileReader reader;
+    long allocStart = allocationCount;
+    Clock::time_point t2 = Clock::now();
+    ControlPtr loaded = reader.read(view);
+    Clock::time_point t3 = Clock::now();
+    long allocations = allocationCount - allocStart;
+
+    ControlPool pool;
+    Clock::time_point t4 = Clock::now();
+    ControlPtr pooled = reader.read(view, &pool);
+    Clock::time_point t5 = Clock::now();
+
+    std::string again;
+    if (loaded) writer.write(*loaded, again);
+    pooled = nullptr;
+
+    // load() maps the file and the text stays in the mapping, saving that tree gives the file again
+    const char* path = "ui_file_bench.guib";
+    writer.save(*root, path);
+    allocStart = allocationCount;
+    Clock::time_point t6 = Clock::now();
+    ControlPtr mapped = reader.load(path);
+    Clock::time_point t7 = Clock::now();
+    long mappedAllocations = allocationCount - allocStart;
+    std::remove(path);
+    bool textInPlace = mapped != nullptr;
+    std::string_view firstText;
+    for (Control* child = mapped ? mapped->getFirstChild() : nullptr; child; child = child->getNextSibling()) {
+        std::string_view text = static_cast<Button*>(child)->getText();
+        if (firstText.empty()) firstText = text;
+        // one after the other in the file, so never further apart than the file is long
+        if (text.data() < firstText.data() || text.data() + text.size() > firstText.data() + data.size()) textInPlace = false;
+    }
+    std::string mappedAgain;
+    if (mapped) writer.write(*mapped, mappedAgain);
+    mapped = nullptr;
+
+    auto mixed = makeMixedScene();
+    mixed -> Layout();
+    std::string mixedData;
+    bool mixedSame = roundTrips(*mixed, mixedData);
+
+    // a cut off file has to be turned down, not read past its end
+    SetTraceLogLevel(LOG_NONE);
+    bool rejectsTruncated = true;
+    for (size_t length : {(size_t)0, sizeof(UiFileHeader), mixedData.size() / 2, mixedData.size() - 4}) {
+        std::vector<uint32_t> cut(length / 4 + 1);
+        std::memcpy(cut.data(), mixedData.data(), length);
+        if (reader.read(std::string_view((const char*)cut.data(), length))) rejectsTruncated = false;
+    }
+    SetTraceLogLevel(LOG_WARNING);
+
+    report(Result{"ui_file"}.add("n", count)
+                            .add("bytes", (double)data.size())
+                            .add("write_ms", nsBetween(t0, t1) / 1e6)
+                            .add("read_ms", nsBetween(t2, t3) / 1e6)
+                            .add("read_pooled_ms", nsBetween(t4, t5) / 1e6)
+                            .add("load_mapped_ms", nsBetween(t6, t7) / 1e6)
+                            .add("allocs_per_control", (double)allocations / (loaded ? loaded->getSubtreeCount() : 1))
+                            .add("mapped_allocs_per_control", (double)mappedAllocations / (loaded ? loaded->getSubtreeCount() : 1))
+                            .check("same_after_round_trip", loaded && again == data)
+                            .check("mapped_same_after_round_trip", mappedAgain == data)
+                            .check("mapped_text_in_place", textInPlace)
+                            .check("mixed_same_after_round_trip", mixedSame)
+                            .check("rejects_truncated", rejectsTruncated));
+}
+
+// Coverage image for makeBenchFont(), every glyph is a box with a hole so
+// text draws both solid and blended pixels
+static Image makeBenchFontImage() {
+    static std::vector<unsigned char> coverage;
+    int width = 95 * 8;
+    int height = 10;
+    if (coverage.empty()) {
+        coverage.assign((size_t)width * height, 0);
+        for (int y = 1; y < height - 1; y++) {
+            for (int x = 0; x < width; x++) {
+                int inGlyph = x % 8;
+                if (inGlyph == 0 || inGlyph == 7) continue;
+                coverage[(size_t)y * width + x] = (y == 1 || y == height - 2 || inGlyph == 1 || inGlyph == 6) ? 255 : 96;
+            }
+        }
+    }
+    return Image{coverage.data(), width, height, 1, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE};
+}
+
+// Full frames of a button grid drawn by the SoftwareBackend with 1 to N threads,
+// every thread count has to give the same pixels
+static void benchSoftware(int count, int width, int height) {
+    std::vector<Button*> buttons;
+    auto root = makeButtonGrid(count, 0, &buttons);
+    for (size_t i = 0; i < buttons.size(); i += 3)
+        buttons[i] -> setColor(Color{(unsigned char)(i * 37), 120, (unsigned char)(i * 11), 160});
+    root -> Layout();
+
+    size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> threadCounts;
+    for (size_t t = 1; t < maxThreads; t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(maxThreads);
+
+    uint64_t serialHash = 0;
+    double serialNs = 0;
+    for (size_t threads : threadCounts) {
+        std::unique_ptr<ThreadPool> pool;
+        if (threads > 1) pool = std::make_unique<ThreadPool>(threads);
+        SoftwareBackend backend(width, height, pool.get());
+        backend.setFontImage(1, makeBenchFontImage());
+        backend.render(*root, BLACK); // warm up
+
+        Clock::time_point t0 = Clock::now();
+        for (int frame = 0; frame < frameCount; frame++) backend.render(*root, BLACK);
+        Clock::time_point t1 = Clock::now();
+
+        // FNV-1a over the whole buffer
+        uint64_t hash = 1469598103934665603ull;
+        const unsigned char* bytes = (const unsigned char*)backend.getPixels();
+        for (size_t i = 0; i < (size_t)width * height * 4; i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+        double frameNs = nsBetween(t0, t1) / frameCount;
+        if (threads == 1) {
+            serialHash = hash;
+            serialNs = frameNs;
+        }
+
+        report(Result{"software"}.add("n", count)
+                                 .add("width", width)
+                                 .add("height", height)
+                                 .add("threads", (double)threads)
+                                 .add("frame_ms", frameNs / 1e6)
+                                 .add("mpix_per_s", (double)width * height / frameNs * 1e3)
+                                 .add("filled_mpix_per_s", (double)backend.getFilledPixels() / frameNs * 1e3)
+                                 .add("speedup", serialNs / frameNs)
+                                 .check("same_as_serial", hash == serialHash));
+    }
+}
+
+struct ExpectedPixel {
+    int x, y;
+    Color color;
+};
+
+// Prints every pixel that is off, so a failing golden scene says where
+static bool pixelsAre(const SoftwareBackend& backend, std::initializer_list<ExpectedPixel> expected) {
+    bool ok = true;
+    for (const ExpectedPixel& e : expected) {
+        Color c = backend.getPixel(e.x, e.y);
+        if (sameColor(c, e.color)) continue;
+        std::fprintf(stderr, "pixel %d,%d is %d %d %d %d, expected %d %d %d %d\n", e.x, e.y,
+                     c.r, c.g, c.b, c.a, e.color.r, e.color.g, e.color.b, e.color.a);
+        ok = false;
+    }
+    return ok;
+}
+
+// Small scenes with every expected pixel worked out by hand, from the pixel
+// centre rule (a pixel is covered when its centre is) and the blend math
+// (t = s*a + d*(255-a) + 128, out = (t + (t >> 8)) >> 8). Drawn on this
+// thread and over a pool, any difference fails the run
+static void benchGolden() {
+    static const unsigned char glyphCoverage[] = {0, 255, 128, 64,
+                                                  255, 0, 32, 200};
+    Image glyphImage = Image{(void*)glyphCoverage, 4, 2, 1, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE};
+    Texture2D glyphTexture = {};
+    glyphTexture.id = 7;
+    TextRun glyphRun;
+    glyphRun.bounds = Vector2{8, 4};
+    glyphRun.glyphs.push_back(GlyphQuad{Rectangle{0, 0, 4, 2}, Rectangle{0, 0, 8, 4}}); // 2x, every texel is 2x2 pixels
+
+    ThreadPool pool(2);
+    for (ThreadPool* threads : {(ThreadPool*)nullptr, &pool}) {
+        Result result{"golden"};
+        result.add("threads", threads ? 2 : 1);
+        DrawList list;
+
+        // an edge on a pixel centre takes that pixel, others round to the nearest centre
+        // the last rect crosses a tile border
+        SoftwareBackend edges(80, 8, threads);
+        edges.clear(BLACK);
+        list.clear();
+        list.rect(Rectangle{2.5f, 0.5f, 3, 2}, WHITE);    // x 2..4, y 0..1
+        list.rect(Rectangle{8.6f, 4, 2.8f, 2}, WHITE);    // x 9..10
+        list.rect(Rectangle{12.6f, 1, 0.8f, 2}, WHITE);   // no centre inside, nothing
+        list.rect(Rectangle{60.5f, 0, 8, 2}, WHITE);      // x 60..67
+        edges.draw(list);
+        result.check("half_pixel_edges", pixelsAre(edges, {
+            {1, 1, BLACK}, {2, 1, WHITE}, {4, 1, WHITE}, {5, 1, BLACK},
+            {3, 0, WHITE}, {3, 1, WHITE}, {3, 2, BLACK},
+            {8, 4, BLACK}, {9, 4, WHITE}, {10, 5, WHITE}, {11, 4, BLACK},
+            {12, 1, BLACK}, {13, 1, BLACK},
+            {59, 0, BLACK}, {60, 0, WHITE}, {63, 1, WHITE}, {64, 1, WHITE}, {67, 0, WHITE}, {68, 0, BLACK}}));
+
+        // 6 wide so the SSE2 path and the scalar rest both get a pixel
+        SoftwareBackend blend(30, 4, threads);
+        blend.clear(WHITE);
+        list.clear();
+        list.rect(Rectangle{0, 0, 6, 4}, Color{0, 0, 255, 128});
+        list.rect(Rectangle{6, 0, 6, 4}, Color{0, 255, 0, 64});
+        list.rect(Rectangle{12, 0, 6, 4}, Color{255, 0, 0, 255});
+        list.rect(Rectangle{18, 0, 6, 4}, Color{0, 0, 0, 128});
+        list.rect(Rectangle{18, 0, 6, 4}, Color{255, 255, 255, 128}); // over the last one
+        list.rect(Rectangle{24, 0, 6, 4}, Color{255, 0, 0, 0});
+        blend.draw(list);
+        result.check("alpha_blend", pixelsAre(blend, {
+            {0, 1, Color{127, 127, 255, 255}}, {5, 1, Color{127, 127, 255, 255}},
+            {6, 1, Color{191, 255, 191, 255}}, {11, 1, Color{191, 255, 191, 255}},
+            {12, 1, Color{255, 0, 0, 255}}, {17, 1, Color{255, 0, 0, 255}},
+            {18, 1, Color{191, 191, 191, 255}}, {23, 1, Color{191, 191, 191, 255}},
+            {24, 1, WHITE}, {29, 1, WHITE}}));
+
+        // over a transparent buffer the alpha comes out as src over dst too
+        SoftwareBackend transparent(6, 1, threads);
+        transparent.clear(BLANK);
+        list.clear();
+        list.rect(Rectangle{0, 0, 6, 1}, Color{255, 0, 0, 128});
+        transparent.draw(list);
+        result.check("alpha_over_blank", pixelsAre(transparent, {{0, 0, Color{128, 0, 0, 128}}, {5, 0, Color{128, 0, 0, 128}}}));
+
+        // nested clips intersect, a pop goes back to the outer one
+        SoftwareBackend clips(16, 16, threads);
+        clips.clear(BLACK);
+        list.clear();
+        list.pushClip(Rectangle{0, 0, 8, 8});
+        list.rect(Rectangle{0, 0, 16, 16}, RED);
+        list.pushClip(Rectangle{4, 4, 8, 8});
+        list.rect(Rectangle{0, 0, 16, 16}, GREEN);
+        list.popClip();
+        list.rect(Rectangle{0, 12, 16, 4}, BLUE); // outside the outer clip
+        list.popClip();
+        list.rect(Rectangle{12, 12, 4, 4}, WHITE);
+        clips.draw(list);
+        result.check("clip_push_pop", pixelsAre(clips, {
+            {0, 0, RED}, {3, 3, RED}, {7, 3, RED}, {4, 4, GREEN}, {7, 7, GREEN},
+            {8, 8, BLACK}, {9, 1, BLACK}, {1, 13, BLACK}, {11, 11, BLACK},
+            {12, 12, WHITE}, {15, 15, WHITE}}));
+
+        // nearest texel, coverage times the tint alpha blends the tint in
+        Color tint = Color{255, 0, 0, 255};
+        SoftwareBackend glyphs(12, 8, threads);
+        glyphs.setFontImage(glyphTexture.id, glyphImage);
+        glyphs.clear(BLACK);
+        list.clear();
+        list.text(glyphTexture, glyphRun, Vector2{1, 1}, tint);
+        glyphs.draw(list);
+        result.check("glyph_sampling", pixelsAre(glyphs, {
+            {0, 0, BLACK}, {1, 1, BLACK}, {2, 2, BLACK},
+            {3, 1, tint}, {4, 2, tint},
+            {5, 2, Color{128, 0, 0, 255}}, {7, 1, Color{64, 0, 0, 255}},
+            {1, 3, tint}, {3, 4, BLACK}, {5, 3, Color{32, 0, 0, 255}}, {8, 4, Color{200, 0, 0, 255}},
+            {9, 1, BLACK}, {1, 5, BLACK}}));
+
+        report(result);
+    }
+}
+
+// Panels only, fanOut wide and depth deep, some of them sticking out of their parent
+static void fillPanels(Panel& panel, int depth, int fanOut, int& count) {
+    for (int i = 0; i < fanOut; i++) {
+        auto child = std::make_unique<Panel>();
+        child -> setPosition((i % 8) * 12 - 4, (i / 8) * 12 - 4);
+        child -> setSize(16, 16);
+        child -> setPadding(1);
+        count++;
+        if (depth > 1) fillPanels(*child, depth - 1, fanOut, count);
+        panel.addChild(std::move(child));
+    }
+}
+
+// Visits what drawChildren() would draw, the pointer chasing way
+static void cullTree(Control& control, Rectangle clip, long& shown) {
+    shown++;
+    RectControl* rect = dynamic_cast<RectControl*>(&control);
+    if (rect && rect->getClipChildren()) clip = rectIntersection(clip, rect->getContentRect());
+    for (Control* child = control.getFirstChild(); child; child = child->getNextSibling()) {
+        if (child->isVisible() && rectsOverlap(child->getSubtreeBounds(), clip)) cullTree(*child, clip, shown);
+    }
+}
+
+static bool sameCommands(const DrawList& a, const DrawList& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        const DrawCommand& x = a.getCommands()[i];
+        const DrawCommand& y = b.getCommands()[i];
+        if (x.type != y.type || !sameColor(x.color, y.color) || x.rect.x != y.rect.x || x.rect.y != y.rect.y ||
+            x.rect.width != y.rect.width || x.rect.height != y.rect.height) return false;
+    }
+    return true;
+}
+
+// Every world, outer and content rect and every subtree bound after the root moved,
+// walking the controls against a GeometryStore over the same tree. Then the store
+// as the context's geometry: sync() after one move or a few resizes, and a
+// draw culled from the store has to record the same list as the pointer walk
+static void benchGeometry(int depth, int fanOut) {
+    auto root = std::make_unique<Panel>();
+    root -> setSize(1920, 1080);
+    int count = 1;
+    fillPanels(*root, depth, fanOut, count);
+    root -> Layout();
+    std::vector<Panel*> panels;
+    panels.reserve(count);
+    std::function<void(Control&)> collect = [&](Control& c) {
+        panels.push_back(static_cast<Panel*>(&c));
+        for (Control* child = c.getFirstChild(); child; child = child->getNextSibling()) collect(*child);
+    };
+    collect(*root);
+
+    int rounds = std::max(1, frameCount / 10);
+    double checksum = 0;
+    Clock::time_point t0 = Clock::now();
+    for (int r = 0; r < rounds; r++) {
+        root -> setPosition(r % 2, r % 3);
+        checksum = 0;
+        for (Panel* p : panels) {
+            Rectangle outer = p->getOuterRect();
+            Rectangle content = p->getContentRect();
+            Rectangle bounds = p->getSubtreeBounds();
+            checksum += outer.x + content.y + bounds.width;
+        }
+    }
+    Clock::time_point t1 = Clock::now();
+    long shownPointer = 0;
+    Rectangle view = Rectangle{0, 0, 1920, 1080};
+    cullTree(*root, view, shownPointer);
+    Clock::time_point t2 = Clock::now();
+
+    GeometryStore store;
+    Clock::time_point t3 = Clock::now();
+    store.build(*root);
+    Clock::time_point t4 = Clock::now();
+    store.build(*root); // again, with the arrays already there
+    double rebuildNs = nsBetween(t4, Clock::now());
+    t4 = Clock::now();
+    for (int r = 0; r < rounds; r++) {
+        store.setLocalPosition(0, r % 2, r % 3);
+        store.update();
+    }
+    Clock::time_point t5 = Clock::now();
+    std::vector<uint32_t> shown;
+    store.cull(view, shown);
+    Clock::time_point t6 = Clock::now();
+
+    // the last round has to agree with the controls
+    double storeChecksum = 0;
+    for (uint32_t i = 0; i < store.size(); i++) {
+        Rectangle outer = store.getOuterRect(i);
+        Rectangle content = store.getContentRect(i);
+        Rectangle bounds = store.getSubtreeBounds(i);
+        storeChecksum += outer.x + content.y + bounds.width;
+    }
+
+    // the opt in way, the controls report changes and sync() reads only those
+    // timed is sync() alone, the controls do their own work when they change
+    UiContext ui;
+    ui.geometry = &store;
+    root -> setContext(&ui);
+    store.sync(*root);
+    auto timeSync = [&]() {
+        Clock::time_point a = Clock::now();
+        store.sync(*root);
+        return nsBetween(a, Clock::now());
+    };
+    double moveSyncNs = 0, resizeSyncNs = 0;
+    std::mt19937 random(18);
+    for (int r = 0; r < rounds; r++) {
+        root -> setPosition(r % 3, r % 2);
+        moveSyncNs += timeSync();
+        for (int k = 0; k < 100; k++) panels[random() % panels.size()] -> setSize(16 + r % 2, 16);
+        root -> Layout();
+        resizeSyncNs += timeSync();
+    }
+
+    Clock::time_point t9 = Clock::now();
+    DrawList fromStore;
+    fromStore.setViewport(view);
+    root -> Draw(fromStore);
+    Clock::time_point t10 = Clock::now();
+    ui.geometry = nullptr;
+    DrawList fromPointers;
+    fromPointers.setViewport(view);
+    root -> Draw(fromPointers);
+    Clock::time_point t11 = Clock::now();
+    root -> setContext(nullptr);
+
+    double nodes = (double)panels.size();
+    report(Result{"geometry"}.add("n", nodes)
+                             .add("depth", depth)
+                             .add("pointer_ns_per_node", nsBetween(t0, t1) / rounds / nodes)
+                             .add("store_ns_per_node", nsBetween(t4, t5) / rounds / nodes)
+                             .add("store_build_ms", nsBetween(t3, t4) / 1e6)
+                             .add("store_rebuild_ms", rebuildNs / 1e6)
+                             .add("store_sync_move_ms", moveSyncNs / rounds / 1e6)
+                             .add("store_sync_100_resized_ms", resizeSyncNs / rounds / 1e6)
+                             .add("pointer_cull_ms", nsBetween(t1, t2) / 1e6)
+                             .add("store_cull_ms", nsBetween(t5, t6) / 1e6)
+                             .add("store_draw_ms", nsBetween(t9, t10) / 1e6)
+                             .add("pointer_draw_ms", nsBetween(t10, t11) / 1e6)
+                             .add("shown", (double)shown.size())
+                             .check("same_as_pointer", storeChecksum == checksum && (long)shown.size() == shownPointer)
+                             .check("same_draw_list", sameCommands(fromStore, fromPointers)));
+}
+
+int main(int argc, char** argv) {
+    const char* filter = nullptr;
+    const char* tracePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frameCount = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--csv") == 0) csvOutput = true;
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) tracePath = argv[++i];
+        else filter = argv[i];
+    }
+    auto wanted = [&](const char* name) {return !filter || std::strstr(name, filter);};
+
+    SetTraceLogLevel(LOG_WARNING);
+    setDefaultFont(makeBenchFont());
+
+    if (wanted("buttons")) {
+        for (int n : {1000, 10000, 100000}) benchButtons(n);
+        benchButtonsChanging(10000);
+    }
+    if (wanted("tree")) {
+        benchTree(4, 8);
+        benchTree(6, 4);
+        benchTree(12, 2);
+    }
+    if (wanted("transforms")) benchTransforms(20, 10000);
+    if (wanted("long_labels")) benchLongLabels(1000, 1000);
+    if (wanted("flex")) benchFlex(10000);
+    if (wanted("hit_test")) benchHitTest(100000, 100000);
+    if (wanted("pool")) benchPool(10000, 10);
+    if (wanted("list_view")) benchListView(10000000, 1000);
+    if (wanted("parallel_text")) benchParallelText(20000, 120);
+    if (wanted("text_area")) benchTextArea(100, 1000);
+    if (wanted("ui_file")) benchUiFile(100000);
+    if (wanted("software")) benchSoftware(10000, 1920, 1080);
+    if (wanted("golden")) benchGolden();
+    if (wanted("geometry")) benchGeometry(4, 32);
+
+    if (tracePath) {
+#ifdef GUILIB_PROFILE
+        Profiler::shared().writeChromeTrace(tracePath);
+#else
+        std::fprintf(stderr, "--trace needs a build with GUILIB_PROFILE\n");
+#endif
+    }
+
+    return failedChecks > 0 ? 1 : 0;
+}
@@ -0,0 +1,5118 @@
+// My GUI Library, the whole library lives in this header
+// include it from the app (main.cpp) or the benchmark (bench.cpp)
+#pragma once
+
+#include "raylib.h"
+#include "iostream"
+#include "memory"
+#include "vector"
+#include "string"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <endian.h>
+#include <fcntl.h>
+#include <functional>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <pthread.h>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unistd.h>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+// For borders , margins and stuff
+struct Edges {
+    float left, right, top, bottom;
+
+    static Edges All(float v) {
+        return Edges{v,v,v,v};
+    }
+
+    static Edges Symmatric(float horizontal, float vertical) {
+        return Edges{horizontal, horizontal, vertical, vertical};
+    }
+
+    bool operator==(const Edges& o) const {
+        return left == o.left && right == o.right && top == o.top && bottom == o.bottom;
+    }
+    bool operator!=(const Edges& o) const {return !(*this == o);}
+};
+
+// for style data on panels and buttons, kept in the StyleTable
+struct Style {
+    Color bgColor;
+    Color borderColor;
+    Edges borderThickness;
+};
+
+inline bool sameColor(Color a, Color b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+// Index of a style in the StyleTable
+using StyleId = uint32_t;
+
+// Every distinct Style is stored once, themes only keep the id
+// styles are never removed, so an id stays valid. Only theme styles go in
+// here, a widget keeps its own overrides, so the table stays small
+class StyleTable {
+    private:
+    std::vector<Style> styles;
+    std::unordered_multimap<size_t, StyleId> lookup;
+
+    static size_t hashStyle(const Style& s) {
+        size_t h = 0;
+        auto mix = [&](size_t v) {h ^= v + 0x9e3779b9 + (h << 6) + (h >> 2);};
+        mix(((size_t)s.bgColor.r << 24) | (s.bgColor.g << 16) | (s.bgColor.b << 8) | s.bgColor.a);
+        mix(((size_t)s.borderColor.r << 24) | (s.borderColor.g << 16) | (s.borderColor.b << 8) | s.borderColor.a);
+        for (float f : {s.borderThickness.left, s.borderThickness.right, s.borderThickness.top, s.borderThickness.bottom})
+            mix(std::hash<float>{}(f));
+        return h;
+    }
+
+    public:
+    static StyleTable& shared() {
+        static StyleTable table;
+        return table;
+    }
+
+    StyleId intern(const Style& style) {
+        size_t h = hashStyle(style);
+        auto range = lookup.equal_range(h);
+        for (auto i = range.first; i != range.second; ++i) {
+            const Style& s = styles[i->second];
+            if (sameColor(s.bgColor, style.bgColor) && sameColor(s.borderColor, style.borderColor) &&
+                s.borderThickness == style.borderThickness) return i->second;
+        }
+        if (styles.size() >= (size_t)std::numeric_limits<StyleId>::max())
+            TraceLog(LOG_FATAL, "STYLE: Style table is full (%zu styles)", styles.size());
+        StyleId id = (StyleId)styles.size();
+        styles.push_back(style);
+        lookup.emplace(h, id);
+        return id;
+    }
+
+    const Style& get(StyleId id) const {return styles[id];}
+    const Style* data() const {return styles.data();}
+    size_t size() const {return styles.size();}
+
+    void clear() {
+        styles.clear();
+        lookup.clear();
+    }
+};
+
+// What a style is used for, a Theme has one style for each
+enum class StyleRole : uint8_t {Panel, Button, ButtonHover, ButtonPressed, Count};
+
+// The look of every widget, switch it with setTheme()
+// starts out as the default look, change it with set()
+class Theme {
+    private:
+    StyleId roles[(size_t)StyleRole::Count];
+
+    public:
+    Theme() {
+        set(StyleRole::Panel, Style{WHITE, WHITE, Edges::All(0)});
+        set(StyleRole::Button, Style{GRAY, DARKGRAY, Edges::All(2)});
+        set(StyleRole::ButtonHover, Style{LIGHTGRAY, BLACK, Edges::All(2)});
+        set(StyleRole::ButtonPressed, Style{DARKGRAY, BLACK, Edges::All(4)});
+    }
+
+    void set(StyleRole role, const Style& style) {roles[(size_t)role] = StyleTable::shared().intern(style);}
+    const Style& get(StyleRole role) const {return StyleTable::shared().get(roles[(size_t)role]);}
+    StyleId getId(StyleRole role) const {return roles[(size_t)role];}
+};
+
+inline const Theme& defaultTheme() {
+    static Theme theme;
+    return theme;
+}
+
+inline const Theme* currentTheme = nullptr;
+inline unsigned themeVersion = 0;       // every switch, Screen repaints everything
+inline unsigned themeLayoutVersion = 0; // switches that changed a border, the next Layout() picks it up
+
+inline const Theme& getTheme() {return currentTheme ? *currentTheme : defaultTheme();}
+
+// Widgets read the theme when they draw, so this is all a switch takes
+// the theme has to stay alive while it is used, nullptr goes back to the default
+inline void setTheme(const Theme* theme) {
+    const Theme& before = getTheme();
+    const Theme& after = theme ? *theme : defaultTheme();
+    currentTheme = theme;
+    themeVersion++;
+    for (size_t role = 0; role < (size_t)StyleRole::Count; role++) {
+        if (before.get((StyleRole)role).borderThickness != after.get((StyleRole)role).borderThickness) {
+            themeLayoutVersion++;
+            break;
+        }
+    }
+}
+
+// Rectangle helpers, empty rects never overlap anything
+inline bool rectsOverlap(Rectangle a, Rectangle b) {
+    return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+inline bool rectIsEmpty(Rectangle r) {
+    return r.width <= 0 || r.height <= 0;
+}
+
+inline Rectangle rectUnion(Rectangle a, Rectangle b) {
+    if (rectIsEmpty(a)) return b;
+    if (rectIsEmpty(b)) return a;
+    float x0 = std::min(a.x, b.x);
+    float y0 = std::min(a.y, b.y);
+    float x1 = std::max(a.x + a.width, b.x + b.width);
+    float y1 = std::max(a.y + a.height, b.y + b.height);
+    return {x0, y0, x1 - x0, y1 - y0};
+}
+
+inline Rectangle rectIntersection(Rectangle a, Rectangle b) {
+    float x0 = std::max(a.x, b.x);
+    float y0 = std::max(a.y, b.y);
+    float x1 = std::min(a.x + a.width, b.x + b.width);
+    float y1 = std::min(a.y + a.height, b.y + b.height);
+    return {x0, y0, std::max(0.0f, x1 - x0), std::max(0.0f, y1 - y0)};
+}
+
+// For measure(), no limit on that axis
+constexpr float Unbounded = INFINITY;
+
+// Counters for seeing how much work the ui does
+struct UiStats {
+    long worldTransformUpdates = 0; // times a world position was recomputed
+    long textMeasurements = 0;      // strings measured and laid out (text cache misses)
+    long layoutPasses = 0;          // onLayout() calls
+    long measurePasses = 0;         // onMeasure() calls (measure cache misses)
+    long drawCalls = 0;             // rects and text runs handed to a render backend
+    long repaintedPixels = 0;       // area of the screen that was repainted
+    long drawnNodes = 0;            // controls whose Draw() ran
+    long culledNodes = 0;           // controls skipped because they were out of view
+
+    void reset() {*this = UiStats{};}
+};
+inline UiStats uiStats;
+
+// ========================================================
+// Profiler
+//
+// Build with GUILIB_PROFILE defined (cmake -DGUILIB_PROFILE=ON) to time the
+// Update, layout and Draw passes per control type, without it the
+// GUI_PROFILE_* macros are empty and nothing is compiled in
+#ifdef GUILIB_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <typeindex>
+#include <typeinfo>
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+class Profiler {
+    public:
+    enum Phase {UpdatePhase, LayoutPhase, MeasurePhase, DrawPhase, PhaseCount};
+
+    // time spent in one control type, children not included
+    struct TypeTotals {
+        const std::type_info* type = nullptr;
+        long calls[PhaseCount] = {};
+        long long ns[PhaseCount] = {};
+    };
+
+    private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Event {
+        const char* name;
+        const std::type_info* type; // set for control scopes
+        long long start;
+        long long duration;
+        int thread;
+    };
+    struct CounterSample {
+        long long time;
+        UiStats stats;
+    };
+
+    Clock::time_point origin = Clock::now();
+    std::mutex lock; // scopes can close on pool threads
+    std::vector<Event> events;
+    std::vector<CounterSample> counters;
+    size_t maxEvents = 1 << 20; // recording stops here, the totals keep going
+
+    std::unordered_map<std::type_index, TypeTotals> frameTotals;
+    std::vector<TypeTotals> lastTotals; // of the last frame, slowest first
+    long long phaseNs[PhaseCount] = {};
+    long long lastPhaseNs[PhaseCount] = {};
+    long long frameStart = 0;
+    long long lastFrameNs = 0;
+    UiStats lastStats;
+
+    static const char* phaseName(int phase) {
+        static const char* names[PhaseCount] = {"Update", "Layout", "Measure", "Draw"};
+        return names[phase];
+    }
+
+    public:
+    static Profiler& shared() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    static std::string typeName(const std::type_info& type) {
+#if defined(__GNUG__)
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+        if (status == 0 && demangled) {
+            std::string name = demangled;
+            std::free(demangled);
+            return name;
+        }
+#endif
+        return type.name();
+    }
+
+    long long now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin).count();
+    }
+
+    // small number for the calling thread, the main thread is usually 0
+    static int threadIndex() {
+        static std::atomic<int> next{0};
+        thread_local int index = next++;
+        return index;
+    }
+
+    void record(const char* name, const std::type_info* type, long long start, long long end) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (events.size() < maxEvents) events.push_back(Event{name, type, start, end - start, threadIndex()});
+    }
+
+    void addPhaseTime(Phase phase, long long ns) {
+        std::lock_guard<std::mutex> guard(lock);
+        phaseNs[phase] += ns;
+    }
+
+    void addControlTime(const std::type_info& type, Phase phase, long long selfNs) {
+        std::lock_guard<std::mutex> guard(lock);
+        TypeTotals& totals = frameTotals[std::type_index(type)];
+        totals.type = &type;
+        totals.calls[phase]++;
+        totals.ns[phase] += selfNs;
+    }
+
+    // Call once per frame after drawing, takes the uiStats counters for the trace
+    void endFrame() {
+        std::lock_guard<std::mutex> guard(lock);
+        long long t = now();
+        lastFrameNs = t - frameStart;
+        frameStart = t;
+        lastStats = uiStats;
+        if (counters.size() < maxEvents) counters.push_back(CounterSample{t, uiStats});
+
+        lastTotals.clear();
+        for (const auto& entry : frameTotals) lastTotals.push_back(entry.second);
+        auto total = [](const TypeTotals& t) {
+            long long sum = 0;
+            for (int p = 0; p < PhaseCount; p++) sum += t.ns[p];
+            return sum;
+        };
+        std::sort(lastTotals.begin(), lastTotals.end(),
+                  [&](const TypeTotals& a, const TypeTotals& b) {return total(a) > total(b);});
+        frameTotals.clear();
+
+        for (int p = 0; p < PhaseCount; p++) {
+            lastPhaseNs[p] = phaseNs[p];
+            phaseNs[p] = 0;
+        }
+    }
+
+    const std::vector<TypeTotals>& getLastFrameTotals() const {return lastTotals;}
+    long long getLastFrameNs() const {return lastFrameNs;}
+    long long getLastPhaseNs(Phase phase) const {return lastPhaseNs[phase];}
+
+    void setMaxEvents(size_t count) {maxEvents = count;}
+    void clear() {
+        std::lock_guard<std::mutex> guard(lock);
+        events.clear();
+        counters.clear();
+    }
+
+    // Writes everything recorded so far, open it in chrome://tracing or Perfetto
+    bool writeChromeTrace(const char* path) const {
+        std::FILE* file = std::fopen(path, "w");
+        if (!file) {
+            TraceLog(LOG_WARNING, "PROFILER: Could not open %s for writing", path);
+            return false;
+        }
+        std::unordered_map<const std::type_info*, std::string> names;
+        std::fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+        bool first = true;
+        for (const Event& e : events) {
+            std::string name = e.name;
+            if (e.type) {
+                auto found = names.find(e.type);
+                if (found == names.end()) found = names.emplace(e.type, typeName(*e.type)).first;
+                name = found->second + "::" + e.name;
+            }
+            std::fprintf(file, "%s{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d}",
+                         first ? "" : ",\n", name.c_str(), e.type ? "control" : "phase", e.start / 1000.0, e.duration / 1000.0, e.thread + 1);
+            first = false;
+        }
+        for (const CounterSample& c : counters) {
+            std::fprintf(file, "%s{\"name\": \"uiStats\", \"ph\": \"C\", \"ts\": %.3f, \"pid\": 1, \"args\": {"
+                         "\"drawCalls\": %ld, \"textMeasurements\": %ld, \"layoutPasses\": %ld, \"drawnNodes\": %ld}}",
+                         first ? "" : ",\n", c.time / 1000.0, c.stats.drawCalls, c.stats.textMeasurements,
+                         c.stats.layoutPasses, c.stats.drawnNodes);
+            first = false;
+        }
+        std::fprintf(file, "\n]}\n");
+        std::fclose(file);
+        TraceLog(LOG_INFO, "PROFILER: Wrote %zu events to %s", events.size() + counters.size(), path);
+        return true;
+    }
+
+    // Timings of the last frame in the corner, drawn straight to the screen
+    // call between BeginDrawing() and EndDrawing()
+    void drawOverlay(int x, int y) const {
+        char line[128];
+        int lineHeight = 12;
+        int lines = 3 + (int)std::min<size_t>(lastTotals.size(), 5);
+        DrawRectangle(x, y, 300, lines * lineHeight + 8, Color{0, 0, 0, 180});
+        x += 4;
+        y += 4;
+
+        std::snprintf(line, sizeof(line), "frame %.2f ms", lastFrameNs / 1e6);
+        DrawText(line, x, y, 10, WHITE);
+        y += lineHeight;
+        std::snprintf(line, sizeof(line), "update %.2f  layout %.2f  draw %.2f ms",
+                      lastPhaseNs[UpdatePhase] / 1e6, lastPhaseNs[LayoutPhase] / 1e6, lastPhaseNs[DrawPhase] / 1e6);
+        DrawText(line, x, y, 10, WHITE);
+        y += lineHeight;
+        std::snprintf(line, sizeof(line), "draw calls %ld  text %ld  layouts %ld",
+                      lastStats.drawCalls, lastStats.textMeasurements, lastStats.layoutPasses);
+        DrawText(line, x, y, 10, WHITE);
+        y += lineHeight;
+
+        for (size_t i = 0; i < lastTotals.size() && i < 5; i++) {
+            const TypeTotals& t = lastTotals[i];
+            long long sum = 0;
+            long calls = 0;
+            for (int p = 0; p < PhaseCount; p++) {
+                sum += t.ns[p];
+                calls += t.calls[p];
+            }
+            std::snprintf(line, sizeof(line), "%-12s %6ld calls %.3f ms", typeName(*t.type).c_str(), calls, sum / 1e6);
+            DrawText(line, x, y, 10, LIGHTGRAY);
+            y += lineHeight;
+        }
+    }
+};
+
+// Times a named part of the frame
+class ProfileScope {
+    private:
+    const char* name;
+    int phase;
+    long long start;
+
+    public:
+    explicit ProfileScope(const char* scopeName, int scopePhase = Profiler::PhaseCount)
+    : name(scopeName), phase(scopePhase), start(Profiler::shared().now()) {}
+
+    ~ProfileScope() {
+        Profiler& profiler = Profiler::shared();
+        long long end = profiler.now();
+        profiler.record(name, nullptr, start, end);
+        if (phase < Profiler::PhaseCount) profiler.addPhaseTime((Profiler::Phase)phase, end - start);
+    }
+};
+
+// Times one control in a pass, the time of the controls under it is taken out
+// of its type's total so every type only gets its own time
+class ControlProfileScope {
+    private:
+    const std::type_info& type;
+    Profiler::Phase phase;
+    long long start;
+    long long childNs = 0;
+    ControlProfileScope* outer;
+
+    static ControlProfileScope*& current() {
+        thread_local ControlProfileScope* scope = nullptr;
+        return scope;
+    }
+
+    public:
+    ControlProfileScope(Profiler::Phase scopePhase, const std::type_info& scopeType)
+    : type(scopeType), phase(scopePhase), start(Profiler::shared().now()), outer(current()) {
+        current() = this;
+    }
+
+    ~ControlProfileScope() {
+        Profiler& profiler = Profiler::shared();
+        long long end = profiler.now();
+        long long duration = end - start;
+        static const char* names[Profiler::PhaseCount] = {"Update", "onLayout", "onMeasure", "Draw"};
+        profiler.record(names[phase], &type, start, end);
+        profiler.addControlTime(type, phase, duration - childNs);
+        current() = outer;
+        if (outer) outer->childNs += duration;
+    }
+};
+
+#define GUI_PROFILE_JOIN2(a, b) a##b
+#define GUI_PROFILE_JOIN(a, b) GUI_PROFILE_JOIN2(a, b)
+#define GUI_PROFILE_SCOPE(name) ProfileScope GUI_PROFILE_JOIN(profileScope_, __LINE__)(name)
+#define GUI_PROFILE_PHASE(name, phase) ProfileScope GUI_PROFILE_JOIN(profileScope_, __LINE__)(name, Profiler::phase)
+#define GUI_PROFILE_CONTROL(phase, control) \
+    ControlProfileScope GUI_PROFILE_JOIN(profileScope_, __LINE__)(Profiler::phase, typeid(*(control)))
+#define GUI_PROFILE_END_FRAME() Profiler::shared().endFrame()
+#define GUI_PROFILE_OVERLAY(x, y) Profiler::shared().drawOverlay(x, y)
+
+#else
+
+#define GUI_PROFILE_SCOPE(name) ((void)0)
+#define GUI_PROFILE_PHASE(name, phase) ((void)0)
+#define GUI_PROFILE_CONTROL(phase, control) ((void)0)
+#define GUI_PROFILE_END_FRAME() ((void)0)
+#define GUI_PROFILE_OVERLAY(x, y) ((void)0)
+
+#endif
+
+// The parts of the screen that have to be repainted
+// overlapping rects are merged, too many of them collapse into one
+class DamageRegion {
+    private:
+    std::vector<Rectangle> rects;
+    static constexpr size_t maxRects = 16;
+
+    public:
+    void add(Rectangle r) {
+        if (rectIsEmpty(r)) return;
+
+        // whole pixels, rounded outwards
+        float x0 = std::floor(r.x);
+        float y0 = std::floor(r.y);
+        r = {x0, y0, std::ceil(r.x + r.width) - x0, std::ceil(r.y + r.height) - y0};
+
+        for (size_t i = 0; i < rects.size();) {
+            if (rectsOverlap(rects[i], r)) {
+                r = rectUnion(rects[i], r);
+                rects[i] = rects.back();
+                rects.pop_back();
+                i = 0; // the bigger rect may touch ones we already passed
+            }
+            else {
+                ++i;
+            }
+        }
+        rects.push_back(r);
+
+        if (rects.size() > maxRects) {
+            Rectangle all = getBounds();
+            rects.clear();
+            rects.push_back(all);
+        }
+    }
+
+    Rectangle getBounds() const {
+        Rectangle all = Rectangle{0, 0, 0, 0};
+        for (const Rectangle& r : rects)
+            all = rectUnion(all, r);
+        return all;
+    }
+
+    const std::vector<Rectangle>& getRects() const {return rects;}
+    bool isEmpty() const {return rects.empty();}
+    void clear() {rects.clear();}
+};
+
+class InputDispatcher;
+class GeometryStore;
+
+// Shared by every control in one tree, set on the root with setContext()
+// the input dispatcher has to be set before that
+struct UiContext {
+    DamageRegion damage;
+    InputDispatcher* input = nullptr;
+    // optional, when set the tree is culled from its flat arrays, see GeometryStore
+    // set it before the tree gets the context, the store only hears of changes after that
+    GeometryStore* geometry = nullptr;
+};
+
+class DrawList;
+class Control;
+class ControlPool;
+class RectControl;
+class ThreadPool;
+struct TextRequest;
+
+// Deletes normally or hands the control back to its pool
+void destroyControl(Control* control);
+
+// Brings the context's GeometryStore up to date before drawing, if there is one
+void syncGeometry(Control& root);
+
+// Handle to a pooled control, goes stale once the control is destroyed
+struct ControlHandle {
+    uint32_t slot = 0;
+    uint32_t generation = 0; // 0 is never used, so a default handle is always stale
+};
+
+struct ControlDeleter {
+    // for pooled controls, the pool's slot generations, gone with the pool
+    std::weak_ptr<const std::vector<uint32_t>> poolGenerations;
+    ControlHandle handle;
+    bool pooled = false;
+
+    ControlDeleter() = default;
+    // so std::unique_ptr<Button> from make_unique converts into a ControlPtr
+    template <typename T>
+    ControlDeleter(const std::default_delete<T>&) {}
+    ControlDeleter(std::weak_ptr<const std::vector<uint32_t>> generations, ControlHandle newHandle)
+    : poolGenerations(std::move(generations)), handle(newHandle), pooled(true) {}
+
+    // a pooled control the pool already tore down (clear() or the pool going away) is left alone
+    void operator()(Control* control) const {
+        if (pooled) {
+            std::shared_ptr<const std::vector<uint32_t>> generations = poolGenerations.lock();
+            if (!generations || (*generations)[handle.slot] != handle.generation) return;
+        }
+        destroyControl(control);
+    }
+};
+
+// Owning pointer to a control, works for both heap and pool controls
+using ControlPtr = std::unique_ptr<Control, ControlDeleter>;
+
+// Base UI class 'Control'
+class Control {
+    protected:
+    Vector2 position = Vector2{0, 0};
+
+    // cached world position, only recomputed after this or a parent moves
+    Vector2 worldPosition = Vector2{0, 0};
+    bool transformDirty = true;
+
+    bool visible = true;
+    bool enabled = true;
+
+    // layout state, see Layout()
+    bool layoutDirty = true;       // this control has to redo its own layout
+    bool childLayoutDirty = false; // something under this control does
+    bool inLayout = false;
+    bool sizedByParent = false;    // a layout container picked our size
+    unsigned themeLayoutSeen = themeLayoutVersion;
+
+    // last two measure() results, layout containers often ask twice with different space
+    struct MeasureEntry {
+        Vector2 available;
+        Vector2 size;
+    };
+    MeasureEntry measureCache[2];
+    int measureCount = 0;          // valid entries, cleared by markLayoutDirty()
+    int measureNext = 0;
+
+    // flex item settings, read by a FlexPanel parent
+    float flexGrow = 0.0f;
+    float flexShrink = 1.0f;
+
+    Control* parent = nullptr; // parent
+
+    // children, owned by this control, in draw order
+    Control* firstChild = nullptr;
+    Control* lastChild = nullptr;
+    Control* prevSibling = nullptr;
+    Control* nextSibling = nullptr;
+    size_t childCount = 0;
+
+    // set when this control lives in a ControlPool
+    ControlPool* pool = nullptr;
+    uint32_t poolSlot = 0;
+    uint32_t poolBytes = 0;
+    friend class ControlPool;
+    friend void destroyControl(Control* control);
+
+    // where this control is in the context's GeometryStore, checked by the store
+    uint32_t geometryIndex = UINT32_MAX;
+    friend class GeometryStore;
+
+    // Let the context's GeometryStore know, they do nothing without one
+    void geometryChanged();          // position, size, insets, visibility or clip
+    void geometryStructureChanged(); // children added or removed
+    bool drawChildrenFromStore(DrawList& list);
+
+    // Takes a child out of the sibling list without destroying it
+    void unlinkChild(Control* child) {
+        if (child->prevSibling) child->prevSibling->nextSibling = child->nextSibling;
+        else firstChild = child->nextSibling;
+        if (child->nextSibling) child->nextSibling->prevSibling = child->prevSibling;
+        else lastChild = child->prevSibling;
+        child->prevSibling = nullptr;
+        child->nextSibling = nullptr;
+        child->parent = nullptr;
+        childCount--;
+        invalidateBounds();
+        geometryStructureChanged();
+    }
+
+    // Call when the local bounds of this control or what is under it changed
+    // if this is already dirty then so are all the parents
+    void invalidateBounds() {
+        geometryChanged();
+        for (Control* c = this; c && !c->boundsDirty; c = c->parent)
+            c->boundsDirty = true;
+    }
+
+    // Draws the children that can be seen through the list's clip
+    void drawChildren(DrawList& list);
+
+    UiContext* context = nullptr;
+
+    // cached bounds of this control and its visible children,
+    // relative to its own world position so moving it keeps them valid
+    Rectangle subtreeBounds = Rectangle{0, 0, 0, 0};
+    size_t subtreeCount = 1;
+    bool childrenOverflow = false; // children reach outside of the child clip
+    bool boundsDirty = true;
+
+    // pointer input, see InputDispatcher
+    bool hitTestable = false;
+    bool hitTestQueued = false;   // waiting for the index to pick up a move
+    int hitTestId = -1;           // entry in the dispatcher's index
+
+    // draw order between siblings, later ones are drawn on top
+    unsigned long siblingKey = 0;
+    unsigned long nextChildKey = 0;
+
+    friend class InputDispatcher;
+    void enterHitTest();
+    void leaveHitTest();
+    void hitTestMoved();
+
+    // Mark the area this control or its whole subtree covers for repainting
+    void damageSelf() {
+        if (context && visible) context -> damage.add(getBounds());
+    }
+    void damageSubtree() {
+        if (context) context -> damage.add(getSubtreeBounds());
+    }
+
+    // Called when the world position is about to change
+    virtual void onTransformChanged() {}
+
+    // Marks this control and everything under it as moved
+    // if this is already dirty then so are all the children
+    void invalidateTransform() {
+        if (transformDirty) return;
+        transformDirty = true;
+        onTransformChanged();
+        hitTestMoved();
+        for (Control* child = firstChild; child; child = child->nextSibling)
+            child -> invalidateTransform();
+    }
+
+    // Measure and arrange this control, only called when it is layout dirty
+    virtual void onLayout() {}
+
+    // The theme changed in a way that can change sizes
+    virtual void onThemeChanged() {}
+
+    void applyTheme() {
+        themeLayoutSeen = themeLayoutVersion;
+        onThemeChanged();
+        for (Control* child = firstChild; child; child = child->nextSibling)
+            child -> applyTheme();
+    }
+
+    // Text that has to be measured before this control can be laid out, see prepareLayout()
+    virtual void collectText(std::vector<TextRequest>& batch) {}
+
+    void gatherText(std::vector<TextRequest>& batch) {
+        if (layoutDirty) collectText(batch);
+        if (!childLayoutDirty) return;
+        for (Control* child = firstChild; child; child = child->nextSibling)
+            child -> gatherText(batch);
+    }
+
+    // Size this control wants to be, margins not included
+    // available is the space the parent can give it, may be Unbounded
+    virtual Vector2 onMeasure(Vector2 available) {
+        Rectangle r = getLocalBounds();
+        return Vector2{r.width, r.height};
+    }
+
+    // Our size was changed from outside, only the layout under us has to be redone
+    void markArrangeDirty() {
+        layoutDirty = true;
+        for (Control* p = parent; p && !p->childLayoutDirty; p = p->parent)
+            p->childLayoutDirty = true;
+    }
+
+    // A flex setting or the visibility of this control changed
+    void parentLayoutChanged() {
+        if (parent && parent->arrangesChildren()) parent->markLayoutDirty();
+    }
+
+    // Rect the children are clipped to, relative to this control's world position
+    virtual bool getLocalChildClip(Rectangle& clip) {return false;}
+
+    // True for controls whose layout depends on their children (like Button)
+    virtual bool arrangesChildren() const {return false;}
+
+    public:
+    Control() = default;
+    // the children are owned through raw links, a copy would destroy them twice
+    Control(const Control&) = delete;
+    Control& operator=(const Control&) = delete;
+    Control(Control&&) = delete;
+    Control& operator=(Control&&) = delete;
+
+    virtual ~Control() {
+        leaveHitTest();
+        geometryStructureChanged();
+        Control* child = firstChild;
+        while (child) {
+            Control* next = child->nextSibling;
+            child->parent = nullptr;
+            destroyControl(child);
+            child = next;
+        }
+    }
+
+    // Pointer events from the InputDispatcher, only for hit testable controls
+    virtual void onPointerEnter() {}
+    virtual void onPointerLeave() {}
+    virtual void onPointerPress() {}
+    virtual void onPointerRelease() {}
+    virtual void onPointerClick() {}
+    // Goes to the hovered control and up its parents until one returns true
+    virtual bool onPointerWheel(float amount) {return false;}
+
+    // Add a control object as a child to this object
+    void addChild(ControlPtr child) {
+        if (!child) return;
+        Control* added = child.release();
+        added -> parent = this;
+        added -> sizedByParent = false;
+        added -> siblingKey = nextChildKey++;
+        added -> prevSibling = lastChild;
+        if (lastChild) lastChild -> nextSibling = added;
+        else firstChild = added;
+        lastChild = added;
+        childCount++;
+        invalidateBounds();
+        geometryStructureChanged();
+
+        added -> invalidateTransform();
+        if (added -> context != context) added -> setContext(context);
+        added -> markLayoutDirty();
+        added -> damageSubtree();
+    }
+    // Remove and destroy a child, O(1) and the other children keep their order
+    void removeChild(Control* child) {
+        if (!child || child->parent != this) return;
+        child -> damageSubtree();
+        unlinkChild(child);
+        destroyControl(child); // DESTROYS child
+        if (arrangesChildren()) markLayoutDirty();
+    }
+
+    Control* getParent() const {return parent;}
+    Control* getFirstChild() const {return firstChild;}
+    Control* getLastChild() const {return lastChild;}
+    Control* getNextSibling() const {return nextSibling;}
+    Control* getPrevSibling() const {return prevSibling;}
+    size_t getChildCount() const {return childCount;}
+
+    // Set on the root, children get it when they are added
+    void setContext(UiContext* newContext) {
+        if (context != newContext) {
+            leaveHitTest();
+            geometryStructureChanged();
+            context = newContext;
+            geometryStructureChanged();
+            enterHitTest();
+        }
+        for (Control* child = firstChild; child; child = child->nextSibling)
+            child -> setContext(newContext);
+        damageSubtree();
+    }
+    UiContext* getContext() const {return context;}
+
+    virtual void setPosition(int x, int y) {
+        Vector2 newPosition = Vector2{(float)x, (float)y};
+        if (newPosition.x == position.x && newPosition.y == position.y) return;
+        damageSubtree();
+        position = newPosition;
+        geometryChanged();
+        invalidateTransform();
+        if (parent) parent -> invalidateBounds();
+        damageSubtree();
+    }
+
+    Vector2 getPosition() const {return position;}
+
+    // Only walks up to the first parent with a valid cache
+    Vector2 getWorldPosition() {
+        if (transformDirty) {
+            if (parent) {
+                Vector2 parentPos = parent -> getWorldPosition();
+                worldPosition = Vector2{parentPos.x + position.x, parentPos.y + position.y};
+            }
+            else {
+                worldPosition = position;
+            }
+            transformDirty = false;
+            uiStats.worldTransformUpdates++;
+        }
+        return worldPosition;
+    }
+
+    void setVisibility(bool visibility) {
+        if (visible == visibility) return;
+        damageSubtree();
+        visible = visibility;
+        geometryChanged();
+        if (parent) parent -> invalidateBounds();
+        damageSubtree();
+        parentLayoutChanged();
+    }
+    bool isVisible() const {return visible;}
+
+    void setEnabled(bool enable) {enabled = enable;}
+    bool isEnabled() const {return enabled;}
+
+    // Visible and enabled, and so are all the parents
+    bool isShown() const {
+        for (const Control* c = this; c; c = c->parent)
+            if (!c->visible || !c->enabled) return false;
+        return true;
+    }
+
+    // False when a parent clips the point away
+    bool isUnclippedAt(Vector2 point) {
+        for (Control* c = parent; c; c = c->parent) {
+            Rectangle clip;
+            if (!c->getLocalChildClip(clip)) continue;
+            Vector2 wp = c->getWorldPosition();
+            if (!CheckCollisionPointRec(point, Rectangle{wp.x + clip.x, wp.y + clip.y, clip.width, clip.height}))
+                return false;
+        }
+        return true;
+    }
+
+    // Hit testable controls get pointer events
+    void setHitTestable(bool testable) {
+        if (hitTestable == testable) return;
+        leaveHitTest();
+        hitTestable = testable;
+        enterHitTest();
+    }
+    bool isHitTestable() const {return hitTestable;}
+
+    // True if this is drawn after (on top of) the other control
+    bool drawsAfter(const Control* other) const {
+        int depth = 0, otherDepth = 0;
+        for (const Control* c = parent; c; c = c->parent) depth++;
+        for (const Control* c = other->parent; c; c = c->parent) otherDepth++;
+
+        const Control* a = this;
+        const Control* b = other;
+        while (depth > otherDepth) {a = a->parent; depth--;}
+        while (otherDepth > depth) {b = b->parent; otherDepth--;}
+        // one is the parent of the other, children are drawn after parents
+        if (a == b) return this != a;
+
+        while (a->parent != b->parent) {
+            a = a->parent;
+            b = b->parent;
+        }
+        return a->siblingKey > b->siblingKey;
+    }
+
+    // Area covered by this control alone, relative to its world position
+    virtual Rectangle getLocalBounds() {return Rectangle{0, 0, 0, 0};}
+
+    // nullptr unless this is a RectControl, cheaper than a dynamic_cast
+    virtual RectControl* asRectControl() {return nullptr;}
+
+    Rectangle getBounds() {
+        Rectangle r = getLocalBounds();
+        Vector2 wp = getWorldPosition();
+        return {wp.x + r.x, wp.y + r.y, r.width, r.height};
+    }
+
+    // Everything this control and its visible children cover, clipping included
+    // relative to the world position like getLocalBounds()
+    Rectangle getLocalSubtreeBounds() {
+        if (boundsDirty) {
+            Rectangle own = getLocalBounds();
+            Rectangle inner = Rectangle{0, 0, 0, 0};
+            subtreeCount = 1;
+            for (Control* child = firstChild; child; child = child->nextSibling) {
+                if (!child->visible) continue;
+                Rectangle r = child -> getLocalSubtreeBounds();
+                inner = rectUnion(inner, Rectangle{child->position.x + r.x, child->position.y + r.y, r.width, r.height});
+                subtreeCount += child->subtreeCount;
+            }
+
+            Rectangle clip;
+            childrenOverflow = false;
+            if (getLocalChildClip(clip) && !rectIsEmpty(inner)) {
+                Rectangle clipped = rectIntersection(inner, clip);
+                childrenOverflow = clipped.x != inner.x || clipped.y != inner.y ||
+                                   clipped.width != inner.width || clipped.height != inner.height;
+                inner = clipped;
+            }
+            subtreeBounds = rectUnion(own, inner);
+            boundsDirty = false;
+        }
+        return subtreeBounds;
+    }
+
+    Rectangle getSubtreeBounds() {
+        if (!visible) return Rectangle{0, 0, 0, 0};
+        Rectangle r = getLocalSubtreeBounds();
+        Vector2 wp = getWorldPosition();
+        return {wp.x + r.x, wp.y + r.y, r.width, r.height};
+    }
+
+    // Number of visible controls in this subtree, this one included
+    size_t getSubtreeCount() {
+        getLocalSubtreeBounds();
+        return subtreeCount;
+    }
+
+    // Call this when something that changes the layout was changed
+    void markLayoutDirty() {
+        layoutDirty = true;
+        measureCount = 0;
+        // parents sized around us measure again too, the ones sized some other way do not care
+        for (Control* p = parent; p && p->arrangesChildren(); p = p->parent)
+            p->measureCount = 0;
+        // let the parents know there is work down here
+        for (Control* p = parent; p && !p->childLayoutDirty; p = p->parent)
+            p->childLayoutDirty = true;
+        // parents sized around us have to redo their layout too
+        if (parent && parent->arrangesChildren() && !parent->inLayout && !parent->layoutDirty)
+            parent->markLayoutDirty();
+    }
+    bool isLayoutDirty() const {return layoutDirty || childLayoutDirty;}
+
+    // Optional, before Layout() or before the tree gets its context (which measures it for damage)
+    // measures the text of everything that is about to be laid out at once, on the pool
+    // when one is given, Layout() then finds it all in the TextCache
+    // labels changed at runtime wait for Layout() to measure and damage their new text,
+    // so calling this every frame picks them up
+    void prepareLayout(ThreadPool* pool);
+
+    // Cached onMeasure(), measured again only after a layout change or for new space
+    Vector2 measure(Vector2 available) {
+        for (int i = 0; i < measureCount; i++) {
+            const MeasureEntry& e = measureCache[i];
+            if (e.available.x == available.x && e.available.y == available.y) return e.size;
+        }
+        Vector2 result;
+        {
+            GUI_PROFILE_CONTROL(MeasurePhase, this);
+            result = onMeasure(available);
+        }
+        measureCache[measureNext] = MeasureEntry{available, result};
+        measureNext = (measureNext + 1) % 2;
+        measureCount = std::min(measureCount + 1, 2);
+        uiStats.measurePasses++;
+        return result;
+    }
+
+    // Called by layout containers, controls that size themselves ignore it
+    virtual void arrange(int width, int height) {sizedByParent = true;}
+
+    // Space to keep around this control in a layout container
+    virtual Edges getLayoutMargin() const {return Edges::All(0);}
+
+    // Share of the free space this control takes in a FlexPanel
+    void setFlexGrow(float grow) {
+        if (flexGrow == grow) return;
+        flexGrow = grow;
+        parentLayoutChanged();
+    }
+    float getFlexGrow() const {return flexGrow;}
+
+    // How much this control gives up when a FlexPanel runs out of space
+    void setFlexShrink(float shrink) {
+        if (flexShrink == shrink) return;
+        flexShrink = shrink;
+        parentLayoutChanged();
+    }
+    float getFlexShrink() const {return flexShrink;}
+
+    // The layout pass, runs once per frame and only visits dirty subtrees
+    void Layout() {
+        // after a theme switch with other borders every control syncs once, before anything is laid out
+        if (themeLayoutSeen != themeLayoutVersion) applyTheme();
+        if (layoutDirty) {
+            GUI_PROFILE_CONTROL(LayoutPhase, this);
+            inLayout = true;
+            onLayout();
+            inLayout = false;
+            layoutDirty = false;
+            uiStats.layoutPasses++;
+        }
+        if (childLayoutDirty) {
+            for (Control* child = firstChild; child; child = child->nextSibling)
+                child -> Layout();
+            childLayoutDirty = false;
+        }
+    }
+
+    virtual void Update() {
+        for (Control* child = firstChild; child; child = child->nextSibling) {
+            GUI_PROFILE_CONTROL(UpdatePhase, child);
+            child -> Update();
+        }
+    }
+    // Records what to draw into the list, nothing is drawn right away
+    virtual void Draw(DrawList& list) {
+        if (!visible) {return;}
+        drawChildren(list);
+    }
+};
+
+// Arena for controls that come and go a lot (like table rows)
+// memory comes from big blocks and is reused by controls of the same size,
+// clear() tears down every control in the pool at once, ControlPtrs still
+// holding one of them do nothing when they go away after that
+class ControlPool {
+    private:
+    struct Slot {
+        Control* control = nullptr;
+    };
+    struct FreeList {
+        size_t bytes;
+        std::vector<void*> chunks;
+    };
+
+    std::vector<Slot> slots;
+    // generation of every slot, shared with the ControlPtrs handed out
+    std::shared_ptr<std::vector<uint32_t>> generations = std::make_shared<std::vector<uint32_t>>();
+    std::vector<uint32_t> freeSlots;
+    std::vector<FreeList> freeLists;
+
+    std::vector<std::unique_ptr<unsigned char[]>> blocks;
+    size_t blockUsed = 0;
+    size_t blockSize;
+
+    size_t liveCount = 0;
+    size_t blockAllocations = 0;
+
+    static constexpr size_t alignment = alignof(std::max_align_t);
+
+    static size_t roundUp(size_t bytes) {
+        return (bytes + alignment - 1) / alignment * alignment;
+    }
+
+    std::vector<void*>& freeListFor(size_t bytes) {
+        for (FreeList& list : freeLists)
+            if (list.bytes == bytes) return list.chunks;
+        freeLists.push_back(FreeList{bytes, {}});
+        return freeLists.back().chunks;
+    }
+
+    void* allocate(size_t bytes) {
+        std::vector<void*>& free = freeListFor(bytes);
+        if (!free.empty()) {
+            void* chunk = free.back();
+            free.pop_back();
+            return chunk;
+        }
+        if (blocks.empty() || blockUsed + bytes > blockSize) {
+            blocks.emplace_back(new unsigned char[std::max(blockSize, bytes)]);
+            blockUsed = 0;
+            blockAllocations++;
+        }
+        void* chunk = blocks.back().get() + blockUsed;
+        blockUsed += bytes;
+        return chunk;
+    }
+
+    uint32_t acquireSlot(Control* control) {
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else {
+            slot = (uint32_t)slots.size();
+            slots.push_back(Slot{});
+            generations->push_back(1);
+        }
+        slots[slot].control = control;
+        return slot;
+    }
+
+    public:
+    // new[] hands out memory aligned for anything, so block starts are fine
+    explicit ControlPool(size_t newBlockSize = 64 * 1024) : blockSize(roundUp(newBlockSize)) {}
+    ~ControlPool() {clear();}
+    ControlPool(const ControlPool&) = delete;
+    ControlPool& operator=(const ControlPool&) = delete;
+
+    template <typename T, typename... Args>
+    std::unique_ptr<T, ControlDeleter> create(Args&&... args) {
+        static_assert(std::is_base_of<Control, T>::value, "ControlPool only holds controls");
+        static_assert(alignof(T) <= alignment, "over aligned controls are not supported");
+
+        size_t bytes = roundUp(sizeof(T));
+        void* memory = allocate(bytes);
+        T* control;
+        try {
+            control = new (memory) T(std::forward<Args>(args)...);
+        }
+        catch (...) {
+            freeListFor(bytes).push_back(memory);
+            throw;
+        }
+        control->pool = this;
+        control->poolBytes = (uint32_t)bytes;
+        control->poolSlot = acquireSlot(control);
+        liveCount++;
+        return std::unique_ptr<T, ControlDeleter>(control, ControlDeleter(generations, getHandle(control)));
+    }
+
+    ControlHandle getHandle(const Control* control) const {
+        if (!control || control->pool != this) return ControlHandle{};
+        return ControlHandle{control->poolSlot, (*generations)[control->poolSlot]};
+    }
+
+    // nullptr when the control behind the handle is gone
+    Control* get(ControlHandle handle) const {
+        if (handle.slot >= slots.size()) return nullptr;
+        return (*generations)[handle.slot] == handle.generation ? slots[handle.slot].control : nullptr;
+    }
+
+    // Destroys one control, use removeChild() or a ControlPtr instead of calling this
+    void release(Control* control) {
+        slots[control->poolSlot].control = nullptr;
+        (*generations)[control->poolSlot]++;
+        freeSlots.push_back(control->poolSlot);
+
+        size_t bytes = control->poolBytes;
+        control->~Control();
+        freeListFor(bytes).push_back(control);
+        liveCount--;
+    }
+
+    // Destroys every control in the pool and frees all of its memory
+    // pooled controls that are children of outside controls get unlinked first
+    void clear() {
+        for (Slot& slot : slots) {
+            Control* c = slot.control;
+            if (!c) continue;
+            if (c->parent && c->parent->pool != this) {
+                Control* outside = c->parent;
+                c->damageSubtree();
+                outside->unlinkChild(c);
+                if (outside->arrangesChildren()) outside->markLayoutDirty();
+            }
+            // children from somewhere else are destroyed the normal way
+            for (Control* child = c->firstChild; child;) {
+                Control* next = child->nextSibling;
+                if (child->pool != this) {
+                    c->unlinkChild(child);
+                    destroyControl(child);
+                }
+                child = next;
+            }
+        }
+
+        // only controls from this pool are left, so nobody has to unlink
+        for (size_t i = 0; i < slots.size(); i++) {
+            Control* c = slots[i].control;
+            if (!c) continue;
+            c->firstChild = nullptr;
+            c->lastChild = nullptr;
+            c->~Control();
+            slots[i].control = nullptr;
+            (*generations)[i]++;
+        }
+
+        freeSlots.clear();
+        for (uint32_t i = (uint32_t)slots.size(); i > 0; i--)
+            freeSlots.push_back(i - 1);
+        freeLists.clear();
+        blocks.clear();
+        blockUsed = 0;
+        liveCount = 0;
+    }
+
+    size_t size() const {return liveCount;}
+    size_t getBlockAllocations() const {return blockAllocations;}
+    size_t getMemoryReserved() const {return blocks.size() * blockSize;}
+};
+
+inline void destroyControl(Control* control) {
+    if (!control) return;
+    if (control->pool) control->pool->release(control);
+    else delete control;
+}
+
+// for base classes with size (width and height)
+class RectControl : public Control{
+    protected:
+    Vector2 size = Vector2{0, 0};
+    Vector2 preferredSize = Vector2{0, 0}; // what setSize() asked for, a layout container may pick another size
+
+    // Layout stuff
+    Edges padding = Edges::All(0);
+    Edges border = Edges::All(0);
+    Edges margin = Edges::All(0);
+
+    // children are clipped to the content rect
+    bool clipChildren = false;
+
+    // cached outer rect in world space
+    Rectangle worldRect = Rectangle{0, 0, 0, 0};
+    bool rectDirty = true;
+
+    void onTransformChanged() override {rectDirty = true;}
+
+    bool getLocalChildClip(Rectangle& clip) override {
+        if (!clipChildren) return false;
+        clip = getLocalContentRect();
+        return true;
+    }
+
+    Vector2 onMeasure(Vector2 available) override {return preferredSize;}
+
+    void resize(Vector2 newSize) {
+        damageSelf();
+        size = newSize;
+        rectDirty = true;
+        invalidateBounds();
+        damageSelf();
+        hitTestMoved();
+    }
+
+    // padding and border together
+    Vector2 getInsets() const {
+        return Vector2{
+            padding.left + padding.right + border.left + border.right,
+            padding.top + padding.bottom + border.top + border.bottom
+        };
+    }
+
+    public:
+    void setSize(int width, int height) {
+        Vector2 newSize = Vector2{(float)width, (float)height};
+        bool samePreferred = newSize.x == preferredSize.x && newSize.y == preferredSize.y;
+        if (samePreferred && (sizedByParent || (newSize.x == size.x && newSize.y == size.y))) return;
+        preferredSize = newSize;
+        // inside a layout container the container decides
+        if (!sizedByParent) resize(newSize);
+        // a control sizing itself in onLayout() is already being laid out
+        if (!inLayout) markLayoutDirty();
+    }
+
+    void arrange(int width, int height) override {
+        sizedByParent = true;
+        Vector2 newSize = Vector2{(float)width, (float)height};
+        if (newSize.x == size.x && newSize.y == size.y) return;
+        resize(newSize);
+        markArrangeDirty();
+    }
+
+    Edges getLayoutMargin() const override {return margin;}
+
+    Vector2 getSize() const {return size;}
+    // 0 on an axis the control sizes itself on
+    Vector2 getPreferredSize() const {return preferredSize;}
+
+    // padding
+    void setPadding(const Edges& paddingEdges) {
+        if (padding == paddingEdges) return;
+        padding = paddingEdges;
+        markLayoutDirty();
+        geometryChanged();
+        if (clipChildren) invalidateBounds();
+    }
+    void setPadding(float all) {setPadding(Edges::All(all));}
+    void setPadding(float horizontal, float vertical) {setPadding(Edges::Symmatric(horizontal, vertical));}
+    Edges getPadding() {return padding;}
+
+    //border
+    virtual void setBorderThickness(const Edges& borderEdges) {
+        if (border == borderEdges) return;
+        border = borderEdges;
+        markLayoutDirty();
+        geometryChanged();
+        if (clipChildren) invalidateBounds();
+        damageSelf();
+    }
+    void setBorderThickness(float all) {setBorderThickness(Edges::All(all));}
+    void setBorderThickness(float horizontal, float vertical) {setBorderThickness(Edges::Symmatric(horizontal, vertical));}
+    Edges getBorder() {return border;}
+
+    //margin
+    void setMargin(const Edges& marginEdges) {
+        if (margin == marginEdges) return;
+        margin = marginEdges;
+        markLayoutDirty();
+    }
+    void setMargin(float all) {setMargin(Edges::All(all));}
+    Edges getMargin() {return margin;}
+
+    Rectangle getLocalBounds() override {return Rectangle{0, 0, size.x, size.y};}
+    RectControl* asRectControl() override {return this;}
+
+    void setClipChildren(bool clip) {
+        if (clipChildren == clip) return;
+        clipChildren = clip;
+        invalidateBounds();
+        damageSubtree();
+    }
+    bool getClipChildren() const {return clipChildren;}
+
+    // Content rect relative to the outer rect
+    Rectangle getLocalContentRect() const {
+        float contentW = size.x - (padding.left + padding.right) - (border.left + border.right);
+        float contentH = size.y - (padding.top  + padding.bottom) - (border.top  + border.bottom);
+        return {
+            padding.left + border.left,
+            padding.top + border.top,
+            std::max(0.0f, contentW),
+            std::max(0.0f, contentH)
+        };
+    }
+
+    // The actual rect
+    Rectangle getOuterRect() {
+        if (rectDirty) {
+            Vector2 wp = getWorldPosition();
+            worldRect = {wp.x, wp.y, size.x, size.y};
+            rectDirty = false;
+        }
+        return worldRect;
+    }
+
+    // for layout stuff
+    Rectangle getLayoutRect() {
+        Rectangle r = getOuterRect();
+        return {
+            r.x - margin.left,
+            r.y - margin.top,
+            r.width + margin.left + margin.right,
+            r.height + margin.top + margin.bottom
+        };
+    }
+
+    Rectangle getContentRect() {
+        Rectangle r = getOuterRect();
+        float contentW = r.width  - (padding.left + padding.right) - (border.left + border.right);
+        float contentH = r.height - (padding.top  + padding.bottom) - (border.top  + border.bottom);
+        // Avoid negative values
+        contentW = std::max(0.0f, contentW);
+        contentH = std::max(0.0f, contentH);
+
+        return {
+            r.x + padding.left + border.left,
+            r.y + padding.top + border.top,
+            contentW,
+            contentH
+        };
+    }
+};
+
+// One glyph of a laid out string, dest is relative to where the text is drawn
+struct GlyphQuad {
+    Rectangle source; // inside the font texture
+    Rectangle dest;
+};
+
+// A measured string with its glyphs already placed
+struct TextRun {
+    Vector2 bounds = Vector2{0, 0};
+    std::vector<GlyphQuad> glyphs;
+
+    // Same quads DrawTextEx would draw, without laying the text out again
+    void draw(Texture2D texture, Vector2 position, Color tint) const {
+        for (const GlyphQuad& g : glyphs) {
+            Rectangle dest = {position.x + g.dest.x, position.y + g.dest.y, g.dest.width, g.dest.height};
+            DrawTexturePro(texture, g.source, dest, Vector2{0, 0}, 0.0f, tint);
+        }
+    }
+};
+
+// ========================================================
+// Threads
+//
+// Work stealing thread pool, every worker has its own queue and takes work
+// from the back of the others once it runs dry. The thread calling
+// parallelFor() helps out until its loop is done.
+// Only for work that does not touch the control tree (text shaping), the
+// tree, damage and input all stay on the main thread
+class ThreadPool {
+    private:
+    struct Task {
+        const std::function<void(size_t, size_t)>* body;
+        size_t begin;
+        size_t end;
+        std::atomic<size_t>* remaining;
+    };
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues; // the last one belongs to the calling thread
+    std::vector<std::thread> workers;
+    std::atomic<size_t> queued{0};
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    // own queue from the front, the others from the back
+    bool takeTask(size_t self, Task& task) {
+        for (size_t i = 0; i < queues.size(); i++) {
+            Queue& q = *queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> guard(q.lock);
+            if (q.tasks.empty()) continue;
+            if (i == 0) {
+                task = q.tasks.front();
+                q.tasks.pop_front();
+            }
+            else {
+                task = q.tasks.back();
+                q.tasks.pop_back();
+            }
+            queued--;
+            return true;
+        }
+        return false;
+    }
+
+    static void run(const Task& task) {
+        (*task.body)(task.begin, task.end);
+        task.remaining->fetch_sub(1, std::memory_order_release);
+    }
+
+    void workerLoop(size_t self) {
+        Task task;
+        while (true) {
+            if (takeTask(self, task)) {
+                run(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(sleepLock);
+            wake.wait(guard, [&] {return stopping || queued > 0;});
+            if (stopping && queued == 0) return;
+        }
+    }
+
+    public:
+    // threads counts the calling thread too, 1 runs everything on the caller
+    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) {
+        threads = std::max<size_t>(threads, 1);
+        for (size_t i = 0; i < threads; i++) queues.push_back(std::make_unique<Queue>());
+        for (size_t i = 0; i + 1 < threads; i++) workers.emplace_back([this, i] {workerLoop(i);});
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const {return queues.size();}
+
+    // Calls body(begin, end) on ranges of [0, count) spread over the threads
+    // and returns once all of them are done, body must not throw
+    void parallelFor(size_t count, const std::function<void(size_t, size_t)>& body, size_t grain = 16) {
+        if (count == 0) return;
+        grain = std::max<size_t>(grain, 1);
+        if (workers.empty() || count <= grain) {
+            body(0, count);
+            return;
+        }
+
+        std::atomic<size_t> remaining{0};
+        size_t chunks = (count + grain - 1) / grain;
+        remaining = chunks;
+        for (size_t c = 0; c < chunks; c++) {
+            Queue& q = *queues[c % queues.size()];
+            std::lock_guard<std::mutex> guard(q.lock);
+            q.tasks.push_back(Task{&body, c * grain, std::min(count, (c + 1) * grain), &remaining});
+        }
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            queued += chunks;
+        }
+        wake.notify_all();
+
+        size_t self = queues.size() - 1;
+        Task task;
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            if (takeTask(self, task)) run(task);
+            else std::this_thread::yield();
+        }
+    }
+};
+
+// Text a control wants measured before the layout pass, see Control::prepareLayout()
+struct TextRequest {
+    Font font;
+    float fontSize;
+    float spacing;
+    std::string_view text;
+    std::shared_ptr<const TextRun>* run; // filled in with the measured run
+};
+
+// Shared cache of measured text, keyed by (font, size, spacing, string)
+// least recently used runs get dropped once the memory budget is used up,
+// labels keep their own reference so dropping a run never breaks them
+class TextCache {
+    private:
+    struct Entry {
+        unsigned int fontId;
+        float fontSize;
+        float spacing;
+        std::string text;
+        size_t hash;
+        size_t bytes;
+        std::shared_ptr<const TextRun> run;
+    };
+
+    std::list<Entry> entries; // most recently used first
+    std::unordered_multimap<size_t, std::list<Entry>::iterator> lookup;
+    size_t budget = 4 * 1024 * 1024;
+    size_t used = 0;
+
+    // raylib's default line spacing for '\n'
+    static constexpr float lineSpacing = 2.0f;
+
+    static size_t hashKey(unsigned int fontId, float fontSize, float spacing, std::string_view text) {
+        size_t h = std::hash<std::string_view>{}(text);
+        h ^= std::hash<unsigned int>{}(fontId) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<float>{}(fontSize) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<float>{}(spacing) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        return h;
+    }
+
+    public:
+    // Does the same walk over the codepoints as DrawTextEx, reusing the run's glyph memory
+    // touches nothing shared, so shapeAll() runs it on other threads
+    static void shape(const Font& font, float fontSize, float spacing, const std::string& text, TextRun& run) {
+        GUI_PROFILE_SCOPE("MeasureText");
+        run.bounds = MeasureTextEx(font, text.c_str(), fontSize, spacing);
+        run.glyphs.clear();
+
+        if (!font.glyphs || !font.recs || font.baseSize <= 0) return;
+
+        float scale = fontSize / font.baseSize;
+        float pad = (float)font.glyphPadding;
+        float x = 0.0f;
+        float y = 0.0f;
+        for (size_t i = 0; i < text.size();) {
+            int byteCount = 0;
+            int codepoint = GetCodepointNext(text.c_str() + i, &byteCount);
+            int index = GetGlyphIndex(font, codepoint);
+            i += std::max(byteCount, 1);
+
+            if (codepoint == '\n') {
+                y += fontSize + lineSpacing;
+                x = 0.0f;
+                continue;
+            }
+
+            Rectangle rec = font.recs[index];
+            const GlyphInfo& glyph = font.glyphs[index];
+            if (codepoint != ' ' && codepoint != '\t') {
+                GlyphQuad q;
+                q.source = {rec.x - pad, rec.y - pad, rec.width + 2.0f*pad, rec.height + 2.0f*pad};
+                q.dest = {
+                    x + glyph.offsetX*scale - pad*scale,
+                    y + glyph.offsetY*scale - pad*scale,
+                    (rec.width + 2.0f*pad)*scale,
+                    (rec.height + 2.0f*pad)*scale
+                };
+                run.glyphs.push_back(q);
+            }
+            if (glyph.advanceX == 0) x += rec.width*scale + spacing;
+            else x += glyph.advanceX*scale + spacing;
+        }
+    }
+
+    private:
+    static std::shared_ptr<TextRun> layout(const Font& font, float fontSize, float spacing, const std::string& text) {
+        auto run = std::make_shared<TextRun>();
+        shape(font, fontSize, spacing, text, *run);
+        run->glyphs.shrink_to_fit();
+        return run;
+    }
+
+    void evict() {
+        // always keep the newest entry even if it is bigger than the budget
+        while (used > budget && entries.size() > 1) {
+            Entry& last = entries.back();
+            auto range = lookup.equal_range(last.hash);
+            for (auto i = range.first; i != range.second; ++i) {
+                if (&*i->second == &last) {
+                    lookup.erase(i);
+                    break;
+                }
+            }
+            used -= last.bytes;
+            entries.pop_back();
+        }
+    }
+
+    // Moves a cached run to the front, nullptr when it is not cached
+    std::shared_ptr<const TextRun> find(unsigned int fontId, float fontSize, float spacing, std::string_view text, size_t h) {
+        auto range = lookup.equal_range(h);
+        for (auto i = range.first; i != range.second; ++i) {
+            Entry& e = *i->second;
+            if (e.fontId == fontId && e.fontSize == fontSize && e.spacing == spacing && e.text == text) {
+                entries.splice(entries.begin(), entries, i->second);
+                return e.run;
+            }
+        }
+        return nullptr;
+    }
+
+    std::shared_ptr<const TextRun> insert(Entry&& e, std::shared_ptr<TextRun> run) {
+        uiStats.textMeasurements++;
+        e.bytes = sizeof(Entry) + sizeof(TextRun) + e.text.capacity() + run->glyphs.capacity()*sizeof(GlyphQuad);
+        e.run = std::move(run);
+
+        used += e.bytes;
+        size_t h = e.hash;
+        entries.push_front(std::move(e));
+        lookup.emplace(h, entries.begin());
+        evict();
+        return entries.front().run;
+    }
+
+    public:
+    static TextCache& shared() {
+        static TextCache cache;
+        return cache;
+    }
+
+    std::shared_ptr<const TextRun> get(const Font& font, float fontSize, float spacing, std::string_view text) {
+        size_t h = hashKey(font.texture.id, fontSize, spacing, text);
+        if (auto run = find(font.texture.id, fontSize, spacing, text, h)) return run;
+
+        Entry e{font.texture.id, fontSize, spacing, std::string(text), h, 0, nullptr};
+        auto run = layout(font, fontSize, spacing, e.text);
+        return insert(std::move(e), std::move(run));
+    }
+
+    // Measures a whole batch, the strings that are not cached yet are laid out on the pool
+    // they go into the cache in batch order, so the cache and uiStats end up
+    // the same as measuring one after the other, with any number of threads
+    void shapeAll(std::vector<TextRequest>& batch, ThreadPool* pool) {
+        struct Miss {
+            size_t request;
+            Entry entry;
+            std::shared_ptr<TextRun> run;
+        };
+        std::vector<Miss> misses;
+        std::vector<size_t> missOf(batch.size(), SIZE_MAX);
+        std::unordered_multimap<size_t, size_t> pending; // hash -> miss, for repeats in the batch
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            const TextRequest& r = batch[i];
+            size_t h = hashKey(r.font.texture.id, r.fontSize, r.spacing, r.text);
+            if (auto run = find(r.font.texture.id, r.fontSize, r.spacing, r.text, h)) {
+                *r.run = run;
+                continue;
+            }
+            auto range = pending.equal_range(h);
+            for (auto p = range.first; p != range.second; ++p) {
+                const Entry& e = misses[p->second].entry;
+                if (e.fontId == r.font.texture.id && e.fontSize == r.fontSize && e.spacing == r.spacing && e.text == r.text) {
+                    missOf[i] = p->second;
+                    break;
+                }
+            }
+            if (missOf[i] != SIZE_MAX) continue;
+            missOf[i] = misses.size();
+            pending.emplace(h, misses.size());
+            misses.push_back(Miss{i, Entry{r.font.texture.id, r.fontSize, r.spacing, std::string(r.text), h, 0, nullptr}, nullptr});
+        }
+
+        auto shape = [&](size_t begin, size_t end) {
+            for (size_t m = begin; m < end; m++) {
+                const TextRequest& r = batch[misses[m].request];
+                misses[m].run = layout(r.font, r.fontSize, r.spacing, misses[m].entry.text);
+            }
+        };
+        if (pool) pool->parallelFor(misses.size(), shape);
+        else shape(0, misses.size());
+
+        std::vector<std::shared_ptr<const TextRun>> shaped;
+        shaped.reserve(misses.size());
+        for (Miss& m : misses) shaped.push_back(insert(std::move(m.entry), std::move(m.run)));
+        for (size_t i = 0; i < batch.size(); i++)
+            if (missOf[i] != SIZE_MAX) *batch[i].run = shaped[missOf[i]];
+    }
+
+    void setBudget(size_t bytes) {
+        budget = bytes;
+        evict();
+    }
+    size_t getBudget() const {return budget;}
+    size_t getMemoryUsed() const {return used;}
+    size_t getEntryCount() const {return entries.size();}
+
+    void clear() {
+        entries.clear();
+        lookup.clear();
+        used = 0;
+    }
+};
+
+inline void Control::prepareLayout(ThreadPool* pool) {
+    std::vector<TextRequest> batch;
+    gatherText(batch);
+    if (!batch.empty()) TextCache::shared().shapeAll(batch, pool);
+}
+
+// ========================================================
+// Drawing
+//
+// Draw() records commands into a DrawList, a RenderBackend then batches
+// them and does the actual drawing
+
+enum class DrawCommandType : unsigned char {
+    Rect,
+    Text,
+    PushClip,
+    PopClip
+};
+
+struct DrawCommand {
+    DrawCommandType type;
+    Color color;
+    Rectangle rect;          // the rect to fill, the clip rect, or the text bounds
+    unsigned int text = 0;   // index into the list's text runs
+};
+
+struct TextDraw {
+    const TextRun* run;      // owned by the label, valid until it changes
+    Texture2D texture;
+};
+
+class DrawList {
+    private:
+    std::vector<DrawCommand> commands;
+    std::vector<TextDraw> texts;
+
+    // what can still be seen, used by controls to skip what can't
+    Rectangle viewport = Rectangle{-1e9f, -1e9f, 2e9f, 2e9f};
+    std::vector<Rectangle> clipStack;
+
+    public:
+    void clear() {
+        commands.clear();
+        texts.clear();
+        clipStack.clear();
+    }
+
+    // Anything outside of this is culled while recording
+    void setViewport(Rectangle r) {viewport = r;}
+    Rectangle getViewport() const {return viewport;}
+
+    // The viewport and every pushed clip together
+    Rectangle getClip() const {
+        return clipStack.empty() ? viewport : clipStack.back();
+    }
+
+    void rect(Rectangle r, Color color) {
+        commands.push_back(DrawCommand{DrawCommandType::Rect, color, r});
+    }
+
+    // Border drawn inside the rect, snapped to whole pixels like DrawRectangle
+    void border(Rectangle outer, const Edges& b, Color color) {
+        float x = (float)(int)outer.x;
+        float y = (float)(int)outer.y;
+        float w = (float)(int)outer.width;
+        float h = (float)(int)outer.height;
+
+        if (b.left > 0)
+            rect({x, y, (float)(int)b.left, h}, color);
+        if (b.right > 0)
+            rect({(float)(int)(outer.x + outer.width - b.right), y, (float)(int)b.right, h}, color);
+        if (b.top > 0)
+            rect({x, y, w, (float)(int)b.top}, color);
+        if (b.bottom > 0)
+            rect({x, (float)(int)(outer.y + outer.height - b.bottom), w, (float)(int)b.bottom}, color);
+    }
+
+    void text(Texture2D texture, const TextRun& run, Vector2 position, Color tint) {
+        Rectangle bounds = {position.x, position.y, run.bounds.x, run.bounds.y};
+        commands.push_back(DrawCommand{DrawCommandType::Text, tint, bounds, (unsigned int)texts.size()});
+        texts.push_back(TextDraw{&run, texture});
+    }
+
+    void pushClip(Rectangle r) {
+        commands.push_back(DrawCommand{DrawCommandType::PushClip, BLANK, r});
+        clipStack.push_back(rectIntersection(getClip(), r));
+    }
+    void popClip() {
+        commands.push_back(DrawCommand{DrawCommandType::PopClip, BLANK, Rectangle{0, 0, 0, 0}});
+        if (!clipStack.empty()) clipStack.pop_back();
+    }
+
+    const std::vector<DrawCommand>& getCommands() const {return commands;}
+    const TextDraw& getText(unsigned int i) const {return texts[i];}
+    size_t size() const {return commands.size();}
+};
+
+inline void Control::drawChildren(DrawList& list) {
+    if (!firstChild) return;
+    if (context && context->geometry && drawChildrenFromStore(list)) return;
+
+    // only clip when something actually sticks out
+    getLocalSubtreeBounds();
+    Rectangle clip;
+    bool clipping = childrenOverflow && getLocalChildClip(clip);
+    if (clipping) {
+        Vector2 wp = getWorldPosition();
+        list.pushClip(Rectangle{wp.x + clip.x, wp.y + clip.y, clip.width, clip.height});
+    }
+
+    Rectangle view = list.getClip();
+    for (Control* child = firstChild; child; child = child->nextSibling) {
+        if (!child->visible) continue;
+        if (!rectsOverlap(child->getSubtreeBounds(), view)) {
+            uiStats.culledNodes += child->subtreeCount;
+            continue;
+        }
+        uiStats.drawnNodes++;
+        GUI_PROFILE_CONTROL(DrawPhase, child);
+        child -> Draw(list);
+    }
+
+    if (clipping) list.popClip();
+}
+
+// Turns a DrawList into draw calls
+// submit() merges adjacent rects of the same color and groups text runs
+// by font texture, the subclasses only see the result
+class RenderBackend {
+    private:
+    std::vector<Rectangle> clipStack;
+    size_t clipBase = 0; // clips given to submit() that the list can't pop
+
+    // pending rect that the next one might be merged into
+    bool hasPending = false;
+    Rectangle pendingRect = Rectangle{0, 0, 0, 0};
+    Color pendingColor = BLANK;
+
+    // text commands waiting to be grouped
+    std::vector<const DrawCommand*> textSpan;
+    std::vector<std::pair<unsigned int, Rectangle>> textGroups; // texture id, bounds of the group
+
+    // Two rects that share a whole edge become one
+    static bool tryMerge(Rectangle& into, Rectangle r) {
+        if (into.y == r.y && into.height == r.height) {
+            if (into.x + into.width == r.x) {into.width += r.width; return true;}
+            if (r.x + r.width == into.x) {into.x = r.x; into.width += r.width; return true;}
+        }
+        if (into.x == r.x && into.width == r.width) {
+            if (into.y + into.height == r.y) {into.height += r.height; return true;}
+            if (r.y + r.height == into.y) {into.y = r.y; into.height += r.height; return true;}
+        }
+        return false;
+    }
+
+    bool isClippedAway(Rectangle r) const {
+        return !clipStack.empty() && !rectsOverlap(r, clipStack.back());
+    }
+
+    void flushRect() {
+        if (!hasPending) return;
+        hasPending = false;
+        drawRect(pendingRect, pendingColor);
+        uiStats.drawCalls++;
+    }
+
+    void addRect(Rectangle r, Color color) {
+        if (r.width <= 0 || r.height <= 0 || color.a == 0) return;
+        if (isClippedAway(r)) return;
+        if (hasPending && sameColor(pendingColor, color) && tryMerge(pendingRect, r)) return;
+        flushRect();
+        hasPending = true;
+        pendingRect = r;
+        pendingColor = color;
+    }
+
+    // Draws the span one texture at a time, in order of first use
+    void flushText(const DrawList& list) {
+        if (textSpan.empty()) return;
+        for (const auto& group : textGroups) {
+            for (const DrawCommand* cmd : textSpan) {
+                const TextDraw& t = list.getText(cmd->text);
+                if (t.texture.id != group.first) continue;
+                drawText(*t.run, t.texture, Vector2{cmd->rect.x, cmd->rect.y}, cmd->color);
+                uiStats.drawCalls++;
+            }
+        }
+        textSpan.clear();
+        textGroups.clear();
+    }
+
+    // Text can only move past text with another texture when they don't overlap,
+    // so a span ends as soon as a run overlaps one from a different group
+    void addText(const DrawList& list, const DrawCommand& cmd) {
+        if (isClippedAway(cmd.rect)) return;
+        unsigned int texture = list.getText(cmd.text).texture.id;
+
+        for (const auto& group : textGroups) {
+            if (group.first != texture && rectsOverlap(group.second, cmd.rect)) {
+                flushText(list);
+                break;
+            }
+        }
+
+        textSpan.push_back(&cmd);
+        for (auto& group : textGroups) {
+            if (group.first == texture) {
+                group.second = rectUnion(group.second, cmd.rect);
+                return;
+            }
+        }
+        textGroups.push_back({texture, cmd.rect});
+    }
+
+    void applyClip() {
+        setClip(clipStack.empty() ? nullptr : &clipStack.back());
+    }
+
+    protected:
+    virtual void drawRect(Rectangle r, Color color) = 0;
+    virtual void drawText(const TextRun& run, Texture2D texture, Vector2 position, Color tint) = 0;
+    virtual void setClip(const Rectangle* clip) = 0; // nullptr turns clipping off
+
+    public:
+    virtual ~RenderBackend() = default;
+
+    // Everything outside of clip is skipped when it is given
+    void submit(const DrawList& list, const Rectangle* clip = nullptr) {
+        GUI_PROFILE_SCOPE("Submit");
+        clipBase = 0;
+        if (clip) {
+            clipStack.push_back(*clip);
+            clipBase = 1;
+            applyClip();
+        }
+        for (const DrawCommand& cmd : list.getCommands()) {
+            switch (cmd.type) {
+                case DrawCommandType::Rect:
+                    flushText(list);
+                    addRect(cmd.rect, cmd.color);
+                    break;
+                case DrawCommandType::Text:
+                    flushRect();
+                    addText(list, cmd);
+                    break;
+                case DrawCommandType::PushClip: {
+                    flushRect();
+                    flushText(list);
+                    Rectangle r = cmd.rect;
+                    if (!clipStack.empty()) r = rectIntersection(r, clipStack.back());
+                    clipStack.push_back(r);
+                    applyClip();
+                    break;
+                }
+                case DrawCommandType::PopClip:
+                    flushRect();
+                    flushText(list);
+                    if (clipStack.size() > clipBase) clipStack.pop_back();
+                    applyClip();
+                    break;
+            }
+        }
+        flushRect();
+        flushText(list);
+        if (!clipStack.empty()) {
+            clipStack.clear();
+            applyClip();
+        }
+    }
+};
+
+// Draws with raylib, call submit() between BeginDrawing() and EndDrawing()
+class RaylibBackend : public RenderBackend {
+    protected:
+    void drawRect(Rectangle r, Color color) override {
+        DrawRectangleRec(r, color);
+    }
+
+    void drawText(const TextRun& run, Texture2D texture, Vector2 position, Color tint) override {
+        run.draw(texture, position, tint);
+    }
+
+    void setClip(const Rectangle* clip) override {
+        if (clip) BeginScissorMode((int)clip->x, (int)clip->y, (int)clip->width, (int)clip->height);
+        else EndScissorMode();
+    }
+};
+
+// Keeps what would have been drawn, no window or GPU needed
+class RecordingBackend : public RenderBackend {
+    public:
+    struct Submitted {
+        DrawCommandType type;
+        Rectangle rect;       // text bounds for text
+        Color color;
+        unsigned int texture; // only for text
+    };
+
+    private:
+    std::vector<Submitted> submitted;
+    int rects = 0;
+    int texts = 0;
+    int clips = 0;
+
+    protected:
+    void drawRect(Rectangle r, Color color) override {
+        submitted.push_back(Submitted{DrawCommandType::Rect, r, color, 0});
+        rects++;
+    }
+
+    void drawText(const TextRun& run, Texture2D texture, Vector2 position, Color tint) override {
+        Rectangle bounds = {position.x, position.y, run.bounds.x, run.bounds.y};
+        submitted.push_back(Submitted{DrawCommandType::Text, bounds, tint, texture.id});
+        texts++;
+    }
+
+    void setClip(const Rectangle* clip) override {
+        if (clip) submitted.push_back(Submitted{DrawCommandType::PushClip, *clip, BLANK, 0});
+        else submitted.push_back(Submitted{DrawCommandType::PopClip, Rectangle{0, 0, 0, 0}, BLANK, 0});
+        clips++;
+    }
+
+    public:
+    const std::vector<Submitted>& getSubmitted() const {return submitted;}
+    int getRectCount() const {return rects;}
+    int getTextCount() const {return texts;}
+    int getClipCount() const {return clips;}
+
+    void reset() {
+        submitted.clear();
+        rects = 0;
+        texts = 0;
+        clips = 0;
+    }
+};
+
+// Draws into an RGBA buffer in memory, no window or GPU needed (CI, thumbnails)
+// submit() only records, the buffer is cut into tiles that are drawn on the
+// thread pool, every tile draws what overlaps it in order so the result does
+// not depend on the thread count. Pixels are drawn when their center is inside
+// a rect, blending is src over dst like raylib's default blend mode
+// text needs the font atlas as an Image, see setFontImage()
+class SoftwareBackend : public RenderBackend {
+    private:
+    static constexpr int tileSize = 64;
+
+    // a pixel rect, [x0, x1) x [y0, y1)
+    struct PixelRect {
+        int x0, y0, x1, y1;
+        bool isEmpty() const {return x0 >= x1 || y0 >= y1;}
+    };
+
+    struct Op {
+        PixelRect area;        // bounds, clipped already
+        Color color;
+        const TextRun* run;    // nullptr for rects
+        const uint8_t* atlas;  // coverage of the font texture
+        int atlasWidth, atlasHeight;
+        Vector2 position;
+    };
+
+    struct Atlas {
+        unsigned int texture;
+        int width, height;
+        std::vector<uint8_t> coverage;
+    };
+
+    int width;
+    int height;
+    std::vector<uint32_t> pixels; // RGBA bytes in memory order
+    ThreadPool* pool;
+
+    std::vector<Op> ops;
+    std::vector<std::vector<uint32_t>> bins; // ops per tile
+    int tilesX, tilesY;
+    PixelRect clip;
+    std::vector<Atlas> atlases;
+    DrawList list;
+
+    long filledPixels = 0;
+
+    static int pixelStart(float v) {return (int)std::ceil(v - 0.5f);}
+
+    PixelRect toPixels(Rectangle r) const {
+        return PixelRect{pixelStart(r.x), pixelStart(r.y), pixelStart(r.x + r.width), pixelStart(r.y + r.height)};
+    }
+
+    static PixelRect intersect(PixelRect a, PixelRect b) {
+        return PixelRect{std::max(a.x0, b.x0), std::max(a.y0, b.y0), std::min(a.x1, b.x1), std::min(a.y1, b.y1)};
+    }
+
+    static uint32_t packColor(Color c) {
+        uint32_t p;
+        std::memcpy(&p, &c, 4);
+        return p;
+    }
+
+    // round(s * a + d * (255 - a)) / 255 for every channel, alpha counts as 255 for
+    // the source so the alpha comes out as src over dst too
+    static uint32_t blendPixel(uint32_t dst, Color c, unsigned a) {
+        uint8_t d[4];
+        std::memcpy(d, &dst, 4);
+        unsigned s[4] = {c.r, c.g, c.b, 255};
+        for (int i = 0; i < 4; i++) {
+            unsigned t = s[i] * a + d[i] * (255 - a) + 128;
+            d[i] = (uint8_t)((t + (t >> 8)) >> 8);
+        }
+        uint32_t out;
+        std::memcpy(&out, d, 4);
+        return out;
+    }
+
+    static void fillSpan(uint32_t* row, int count, Color c) {
+        if (c.a == 255) {
+            std::fill(row, row + count, packColor(c));
+            return;
+        }
+        int i = 0;
+#if defined(__SSE2__)
+        // same math as blendPixel(), 2 pixels per 16 bit half
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i inverse = _mm_set1_epi16((short)(255 - c.a));
+        const __m128i source = _mm_setr_epi16(c.r * c.a + 128, c.g * c.a + 128, c.b * c.a + 128, 255 * c.a + 128,
+                                              c.r * c.a + 128, c.g * c.a + 128, c.b * c.a + 128, 255 * c.a + 128);
+        for (; i + 4 <= count; i += 4) {
+            __m128i d = _mm_loadu_si128((const __m128i*)(row + i));
+            __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inverse), source);
+            __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inverse), source);
+            lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+            hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+            _mm_storeu_si128((__m128i*)(row + i), _mm_packus_epi16(lo, hi));
+        }
+#endif
+        for (; i < count; i++) row[i] = blendPixel(row[i], c, c.a);
+    }
+
+    void fillRect(PixelRect r, Color c) {
+        for (int y = r.y0; y < r.y1; y++) fillSpan(&pixels[(size_t)y * width + r.x0], r.x1 - r.x0, c);
+    }
+
+    // glyphs are sampled nearest like a point filtered texture
+    void drawGlyphs(const Op& op, PixelRect area) {
+        for (const GlyphQuad& g : op.run->glyphs) {
+            Rectangle dest = {op.position.x + g.dest.x, op.position.y + g.dest.y, g.dest.width, g.dest.height};
+            PixelRect r = intersect(toPixels(dest), area);
+            if (r.isEmpty() || dest.width <= 0 || dest.height <= 0) continue;
+            float scaleX = g.source.width / dest.width;
+            float scaleY = g.source.height / dest.height;
+            int srcX0 = std::max(0, (int)g.source.x);
+            int srcY0 = std::max(0, (int)g.source.y);
+            int srcX1 = std::min(op.atlasWidth, (int)(g.source.x + g.source.width)) - 1;
+            int srcY1 = std::min(op.atlasHeight, (int)(g.source.y + g.source.height)) - 1;
+            if (srcX1 < srcX0 || srcY1 < srcY0) continue;
+
+            for (int y = r.y0; y < r.y1; y++) {
+                int sy = std::clamp((int)(g.source.y + (y + 0.5f - dest.y) * scaleY), srcY0, srcY1);
+                const uint8_t* src = op.atlas + (size_t)sy * op.atlasWidth;
+                uint32_t* row = &pixels[(size_t)y * width];
+                for (int x = r.x0; x < r.x1; x++) {
+                    int sx = std::clamp((int)(g.source.x + (x + 0.5f - dest.x) * scaleX), srcX0, srcX1);
+                    unsigned a = (op.color.a * src[sx] + 127) / 255;
+                    if (a == 255) row[x] = packColor(op.color);
+                    else if (a > 0) row[x] = blendPixel(row[x], op.color, a);
+                }
+            }
+        }
+    }
+
+    void drawTile(size_t tile) {
+        int tx = (int)(tile % tilesX) * tileSize;
+        int ty = (int)(tile / tilesX) * tileSize;
+        PixelRect tileRect = PixelRect{tx, ty, std::min(tx + tileSize, width), std::min(ty + tileSize, height)};
+        for (uint32_t index : bins[tile]) {
+            const Op& op = ops[index];
+            PixelRect r = intersect(op.area, tileRect);
+            if (op.run) drawGlyphs(op, r);
+            else fillRect(r, op.color);
+        }
+        bins[tile].clear();
+    }
+
+    void addOp(const Op& op) {
+        if (op.area.isEmpty()) return;
+        uint32_t index = (uint32_t)ops.size();
+        ops.push_back(op);
+        for (int ty = op.area.y0 / tileSize; ty <= (op.area.y1 - 1) / tileSize; ty++)
+            for (int tx = op.area.x0 / tileSize; tx <= (op.area.x1 - 1) / tileSize; tx++)
+                bins[(size_t)ty * tilesX + tx].push_back(index);
+    }
+
+    const Atlas* findAtlas(unsigned int texture) const {
+        for (const Atlas& atlas : atlases)
+            if (atlas.texture == texture) return &atlas;
+        return nullptr;
+    }
+
+    protected:
+    void drawRect(Rectangle r, Color color) override {
+        PixelRect area = intersect(toPixels(r), clip);
+        if (!area.isEmpty()) filledPixels += (long)(area.x1 - area.x0) * (area.y1 - area.y0);
+        addOp(Op{area, color, nullptr, nullptr, 0, 0, Vector2{0, 0}});
+    }
+
+    void drawText(const TextRun& run, Texture2D texture, Vector2 position, Color tint) override {
+        const Atlas* atlas = findAtlas(texture.id);
+        if (!atlas) return;
+        // the glyphs can reach out of the run bounds a bit
+        Rectangle bounds = Rectangle{position.x, position.y, 0, 0};
+        for (const GlyphQuad& g : run.glyphs) {
+            Rectangle dest = {position.x + g.dest.x, position.y + g.dest.y, g.dest.width, g.dest.height};
+            bounds = (bounds.width <= 0 && bounds.height <= 0) ? dest : rectUnion(bounds, dest);
+        }
+        PixelRect area = intersect(toPixels(bounds), clip);
+        addOp(Op{area, tint, &run, atlas->coverage.data(), atlas->width, atlas->height, position});
+    }
+
+    void setClip(const Rectangle* r) override {
+        PixelRect all = PixelRect{0, 0, width, height};
+        clip = r ? intersect(toPixels(*r), all) : all;
+    }
+
+    public:
+    // without a pool the tiles are drawn on this thread
+    SoftwareBackend(int newWidth, int newHeight, ThreadPool* newPool = nullptr)
+    : width(std::max(newWidth, 1)), height(std::max(newHeight, 1)), pool(newPool) {
+        pixels.assign((size_t)width * height, packColor(BLANK));
+        tilesX = (width + tileSize - 1) / tileSize;
+        tilesY = (height + tileSize - 1) / tileSize;
+        bins.resize((size_t)tilesX * tilesY);
+        clip = PixelRect{0, 0, width, height};
+    }
+
+    // The font atlas behind a texture id, text with other textures is skipped
+    // grayscale, gray alpha and RGBA images work, only the coverage is kept
+    bool setFontImage(unsigned int texture, const Image& image) {
+        Atlas atlas = Atlas{texture, image.width, image.height, {}};
+        size_t count = (size_t)image.width * image.height;
+        const uint8_t* data = (const uint8_t*)image.data;
+        if (!data || count == 0) return false;
+        atlas.coverage.resize(count);
+        if (image.format == PIXELFORMAT_UNCOMPRESSED_GRAYSCALE) std::memcpy(atlas.coverage.data(), data, count);
+        else if (image.format == PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA) for (size_t i = 0; i < count; i++) atlas.coverage[i] = data[i * 2 + 1];
+        else if (image.format == PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) for (size_t i = 0; i < count; i++) atlas.coverage[i] = data[i * 4 + 3];
+        else {
+            TraceLog(LOG_WARNING, "IMAGE: Font atlas format %i is not supported by the software backend", image.format);
+            return false;
+        }
+        for (Atlas& a : atlases) {
+            if (a.texture == texture) {
+                a = std::move(atlas);
+                return true;
+            }
+        }
+        atlases.push_back(std::move(atlas));
+        return true;
+    }
+
+    void clear(Color color) {
+        std::fill(pixels.begin(), pixels.end(), packColor(color));
+    }
+
+    // Draws a list into the buffer, clip works like in submit()
+    void draw(const DrawList& drawList, const Rectangle* clipRect = nullptr) {
+        ops.clear();
+        filledPixels = 0;
+        submit(drawList, clipRect);
+
+        GUI_PROFILE_SCOPE("Rasterize");
+        if (pool) pool->parallelFor(bins.size(), [&](size_t begin, size_t end) {
+            for (size_t tile = begin; tile < end; tile++) drawTile(tile);
+        }, 1);
+        else for (size_t tile = 0; tile < bins.size(); tile++) drawTile(tile);
+    }
+
+    // Draws a laid out tree over a cleared buffer
+    void render(Control& root, Color background) {
+        syncGeometry(root);
+        list.clear();
+        list.setViewport(Rectangle{0, 0, (float)width, (float)height});
+        root.Draw(list);
+        clear(background);
+        draw(list);
+    }
+
+    int getWidth() const {return width;}
+    int getHeight() const {return height;}
+    const uint32_t* getPixels() const {return pixels.data();}
+    Color getPixel(int x, int y) const {
+        Color c;
+        std::memcpy(&c, &pixels[(size_t)y * width + x], 4);
+        return c;
+    }
+
+    // Points at the buffer, don't unload it, ExportImage() saves it
+    Image getImage() {
+        return Image{pixels.data(), width, height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+    }
+
+    // Pixels the last draw() filled, overlaps counted again
+    long getFilledPixels() const {return filledPixels;}
+};
+
+// Keeps the last frame in a render texture and only repaints what was damaged
+// needs the window to be open before it is created
+class Screen {
+    private:
+    RenderTexture2D target;
+    int width;
+    int height;
+    Color clearColor;
+    DrawList list;
+    bool fullRepaint = true;
+    unsigned themeSeen = themeVersion; // a theme switch repaints everything
+
+    public:
+    Screen(int newWidth, int newHeight, Color newClearColor)
+    : width(newWidth), height(newHeight), clearColor(newClearColor) {
+        target = LoadRenderTexture(width, height);
+    }
+    ~Screen() {
+        UnloadRenderTexture(target);
+    }
+    Screen(const Screen&) = delete;
+    Screen& operator=(const Screen&) = delete;
+
+    // Repaint the next frame completely
+    void invalidate() {fullRepaint = true;}
+
+    // Repaints the damaged parts of the tree into the render texture
+    // returns false when nothing had to be drawn
+    bool render(Control& root, UiContext& ui, RenderBackend& backend) {
+        Rectangle screenRect = Rectangle{0, 0, (float)width, (float)height};
+        if (themeSeen != themeVersion) {
+            themeSeen = themeVersion;
+            fullRepaint = true;
+        }
+        if (fullRepaint) {
+            ui.damage.add(screenRect);
+            fullRepaint = false;
+        }
+        if (ui.damage.isEmpty()) return false;
+
+        syncGeometry(root);
+        list.clear();
+        list.setViewport(rectIntersection(ui.damage.getBounds(), screenRect));
+        uiStats.drawnNodes++;
+        root.Draw(list);
+
+        BeginTextureMode(target);
+        for (const Rectangle& damaged : ui.damage.getRects()) {
+            Rectangle r = rectIntersection(damaged, screenRect);
+            if (rectIsEmpty(r)) continue;
+
+            BeginScissorMode((int)r.x, (int)r.y, (int)r.width, (int)r.height);
+            ClearBackground(clearColor);
+            EndScissorMode();
+
+            backend.submit(list, &r);
+            uiStats.repaintedPixels += (long)(r.width * r.height);
+        }
+        EndTextureMode();
+
+        ui.damage.clear();
+        return true;
+    }
+
+    // Draws the kept frame, call between BeginDrawing() and EndDrawing()
+    void present() {
+        // render textures are upside down
+        DrawTextureRec(target.texture, Rectangle{0, 0, (float)width, (float)-height}, Vector2{0, 0}, WHITE);
+    }
+};
+
+// ========================================================
+// Input
+//
+// Loose quadtree over the bounds of hit testable controls
+// every node also takes rects poking out of it by up to half its size, so a
+// rect sits in the node matching its size and small rects on a split line
+// don't all end up in the root
+class QuadTree {
+    private:
+    struct Node {
+        Rectangle bounds;
+        int firstChild = -1;      // the 4 children are next to each other
+        int depth = 0;
+        std::vector<int> items;
+    };
+    struct Item {
+        Control* control = nullptr;
+        Rectangle rect = Rectangle{0, 0, 0, 0};
+        int node = -1;
+        int slot = -1;            // index in the node's items
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Item> items;
+    std::vector<int> freeItems;
+
+    static constexpr int maxDepth = 12;
+    static constexpr size_t splitCount = 8;
+
+    static Rectangle loose(Rectangle b) {
+        return {b.x - b.width / 2.0f, b.y - b.height / 2.0f, b.width * 2.0f, b.height * 2.0f};
+    }
+
+    static bool contains(Rectangle outer, Rectangle r) {
+        return r.x >= outer.x && r.y >= outer.y &&
+               r.x + r.width <= outer.x + outer.width && r.y + r.height <= outer.y + outer.height;
+    }
+
+    // the child the rect's center falls in if the rect fits there, or -1
+    int childFor(int node, Rectangle r) const {
+        int first = nodes[node].firstChild;
+        if (first < 0) return -1;
+        Rectangle b = nodes[node].bounds;
+        float cx = r.x + r.width / 2.0f;
+        float cy = r.y + r.height / 2.0f;
+        int child = first + (cx >= b.x + b.width / 2.0f ? 1 : 0) + (cy >= b.y + b.height / 2.0f ? 2 : 0);
+        return contains(loose(nodes[child].bounds), r) ? child : -1;
+    }
+
+    int findNode(Rectangle r) const {
+        int node = 0;
+        for (int child = childFor(node, r); child >= 0; child = childFor(node, r))
+            node = child;
+        return node;
+    }
+
+    void addToNode(int node, int id) {
+        items[id].node = node;
+        items[id].slot = (int)nodes[node].items.size();
+        nodes[node].items.push_back(id);
+    }
+
+    void removeFromNode(int id) {
+        Item& item = items[id];
+        std::vector<int>& list = nodes[item.node].items;
+        int moved = list.back();
+        list[item.slot] = moved;
+        items[moved].slot = item.slot;
+        list.pop_back();
+        item.node = -1;
+        item.slot = -1;
+    }
+
+    void split(int node) {
+        Rectangle b = nodes[node].bounds;
+        float hw = b.width / 2.0f;
+        float hh = b.height / 2.0f;
+        int first = (int)nodes.size();
+        int depth = nodes[node].depth + 1;
+        nodes.push_back(Node{{b.x, b.y, hw, hh}, -1, depth, {}});
+        nodes.push_back(Node{{b.x + hw, b.y, hw, hh}, -1, depth, {}});
+        nodes.push_back(Node{{b.x, b.y + hh, hw, hh}, -1, depth, {}});
+        nodes.push_back(Node{{b.x + hw, b.y + hh, hw, hh}, -1, depth, {}});
+        nodes[node].firstChild = first;
+
+        // push down what fits into the new children
+        std::vector<int> old;
+        old.swap(nodes[node].items);
+        for (int id : old) {
+            int child = childFor(node, items[id].rect);
+            addToNode(child >= 0 ? child : node, id);
+        }
+    }
+
+    void place(int id) {
+        int node = findNode(items[id].rect);
+        addToNode(node, id);
+        if (nodes[node].firstChild < 0 && nodes[node].items.size() > splitCount && nodes[node].depth < maxDepth)
+            split(node);
+    }
+
+    public:
+    // Rects outside of the area still work, they just stay in the root
+    explicit QuadTree(Rectangle area) {
+        nodes.push_back(Node{area, -1, 0, {}});
+    }
+
+    int insert(Control* control, Rectangle rect) {
+        int id;
+        if (!freeItems.empty()) {
+            id = freeItems.back();
+            freeItems.pop_back();
+        }
+        else {
+            id = (int)items.size();
+            items.push_back(Item{});
+        }
+        items[id].control = control;
+        items[id].rect = rect;
+        place(id);
+        return id;
+    }
+
+    void remove(int id) {
+        removeFromNode(id);
+        items[id].control = nullptr;
+        freeItems.push_back(id);
+    }
+
+    void update(int id, Rectangle rect) {
+        items[id].rect = rect;
+        if (findNode(rect) == items[id].node) return;
+        removeFromNode(id);
+        place(id);
+    }
+
+    // Calls visit(control) for every rect containing the point
+    // at most 4 nodes per level can hold such a rect
+    template <typename Visit>
+    void query(Vector2 point, Visit&& visit) const {
+        int stack[4 * (maxDepth + 1) + 1];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node& node = nodes[stack[--top]];
+            for (int id : node.items) {
+                const Item& item = items[id];
+                if (CheckCollisionPointRec(point, item.rect)) visit(item.control);
+            }
+            if (node.firstChild < 0) continue;
+            for (int i = 0; i < 4; i++) {
+                if (CheckCollisionPointRec(point, loose(nodes[node.firstChild + i].bounds)))
+                    stack[top++] = node.firstChild + i;
+            }
+        }
+    }
+
+    size_t size() const {return items.size() - freeItems.size();}
+};
+
+// Finds the topmost control under the pointer and sends it pointer events
+// the pressed control captures the pointer until the button is released
+class InputDispatcher {
+    private:
+    QuadTree index;
+    std::vector<Control*> moved;
+
+    Control* hovered = nullptr;
+    Control* captured = nullptr;
+
+    void flushMoved() {
+        for (Control* c : moved) {
+            c->hitTestQueued = false;
+            if (c->hitTestId >= 0) index.update(c->hitTestId, c->getBounds());
+        }
+        moved.clear();
+    }
+
+    public:
+    explicit InputDispatcher(Rectangle area) : index(area) {}
+
+    void add(Control* control) {
+        if (control->hitTestId >= 0) return;
+        control->hitTestId = index.insert(control, control->getBounds());
+    }
+
+    void remove(Control* control) {
+        if (control->hitTestId < 0) return;
+        index.remove(control->hitTestId);
+        control->hitTestId = -1;
+        if (control->hitTestQueued) {
+            moved.erase(std::find(moved.begin(), moved.end(), control));
+            control->hitTestQueued = false;
+        }
+        if (hovered == control) hovered = nullptr;
+        if (captured == control) captured = nullptr;
+    }
+
+    // Bounds are picked up again right before the next hit test
+    void markMoved(Control* control) {
+        if (control->hitTestQueued || control->hitTestId < 0) return;
+        control->hitTestQueued = true;
+        moved.push_back(control);
+    }
+
+    // The control drawn on top at the point, hidden and disabled ones are skipped
+    Control* hitTest(Vector2 point) {
+        flushMoved();
+        Control* top = nullptr;
+        index.query(point, [&](Control* c) {
+            if (top && !c->drawsAfter(top)) return;
+            if (c->isShown() && c->isUnclippedAt(point)) top = c;
+        });
+        return top;
+    }
+
+    // Feed one pointer state, update() does this with the raylib mouse
+    void handlePointer(Vector2 point, bool pressed, bool released, float wheel = 0.0f) {
+        Control* target = hitTest(point);
+        if (target != hovered) {
+            if (hovered) hovered->onPointerLeave();
+            hovered = target;
+            if (hovered) hovered->onPointerEnter();
+        }
+        if (pressed && hovered) {
+            captured = hovered;
+            captured->onPointerPress();
+        }
+        if (released && captured) {
+            Control* c = captured;
+            captured = nullptr;
+            c->onPointerRelease();
+            if (c == hovered) c->onPointerClick();
+        }
+        if (wheel != 0.0f) {
+            for (Control* c = hovered; c; c = c->getParent())
+                if (c->onPointerWheel(wheel)) break;
+        }
+    }
+
+    void update() {
+        handlePointer(GetMousePosition(), IsMouseButtonPressed(MOUSE_LEFT_BUTTON), IsMouseButtonReleased(MOUSE_LEFT_BUTTON), GetMouseWheelMove());
+    }
+
+    Control* getHovered() const {return hovered;}
+    Control* getCaptured() const {return captured;}
+    size_t size() const {return index.size();}
+};
+
+inline void Control::enterHitTest() {
+    if (hitTestable && context && context->input) context->input->add(this);
+}
+
+inline void Control::leaveHitTest() {
+    if (hitTestId >= 0 && context && context->input) context->input->remove(this);
+}
+
+inline void Control::hitTestMoved() {
+    if (hitTestId >= 0 && context && context->input) context->input->markMoved(this);
+}
+
+// Display Text inside the window
+// Font new labels start with, raylib's default font unless another one was set
+// raylib only loads that one in InitWindow(), so the benchmark brings its own
+inline Font labelDefaultFont = Font{};
+
+inline void setDefaultFont(Font font) {labelDefaultFont = font;}
+inline Font getDefaultFont() {return labelDefaultFont.glyphs ? labelDefaultFont : GetFontDefault();}
+
+class Label : public Control{
+    private:
+    std::string ownText;    // the text, unless it lives somewhere else (see setTextInPlace())
+    std::string_view text;  // what is shown, ownText or memory textOwner keeps alive
+    std::shared_ptr<const void> textOwner;
+    Font font = getDefaultFont();
+    int fontSize = 16;
+    Color color = BLACK;
+
+    // measured lazily, only after the text or font size changed
+    mutable std::shared_ptr<const TextRun> run;
+
+    // the new text is damaged in onLayout(), once prepareLayout() had the chance to measure it
+    bool newTextDamaged = true;
+
+    // the old text was drawn only if it was measured
+    void textChanging() {
+        if (run) damageSelf();
+    }
+
+    void textChanged() {
+        run = nullptr;
+        invalidateBounds();
+        markLayoutDirty();
+        newTextDamaged = false;
+    }
+
+    // same size and spacing DrawText uses for the default font
+    float drawFontSize() const {return (float)std::max(fontSize, 10);}
+    float drawSpacing() const {return (float)(std::max(fontSize, 10)/10);}
+
+    const TextRun& getRun() const {
+        if (!run) run = TextCache::shared().get(font, drawFontSize(), drawSpacing(), text);
+        return *run;
+    }
+
+    protected:
+    void onLayout() override {
+        getTextBounds();
+        if (!newTextDamaged) {
+            damageSelf();
+            newTextDamaged = true;
+        }
+    }
+
+    void collectText(std::vector<TextRequest>& batch) override {
+        if (!run) batch.push_back(TextRequest{font, drawFontSize(), drawSpacing(), text, &run});
+    }
+
+    public:
+
+    explicit Label(std::string newText, int newFontSize)
+    : ownText(std::move(newText)), text(ownText), fontSize(newFontSize){
+    }
+
+    void setText(std::string_view newText) {
+        if (text == newText) return;
+        textChanging();
+        ownText.assign(newText);
+        text = ownText;
+        textOwner = nullptr; // newText may have been in there
+        textChanged();
+    }
+
+    // Shows text without copying it, owner keeps the memory it is in alive (like a mapped ui file)
+    void setTextInPlace(std::string_view newText, std::shared_ptr<const void> owner) {
+        textChanging();
+        textOwner = std::move(owner);
+        text = newText;
+        ownText.clear();
+        textChanged();
+    }
+
+    std::string_view getText() const {return text;}
+
+    void setFontSize(int newFontSize) {
+        if (fontSize == newFontSize) return;
+        textChanging();
+        fontSize = newFontSize;
+        textChanged();
+    }
+    int getFontSize() const {return fontSize;}
+
+    int getTextSize() const {return (int)getRun().bounds.x;}
+
+    Vector2 getTextBounds() const {return getRun().bounds;}
+
+    Rectangle getLocalBounds() override {
+        Vector2 b = getTextBounds();
+        return Rectangle{0, 0, b.x, b.y};
+    }
+
+
+    void setPosition(int x, int y) override {
+        Control::setPosition(x, y);
+    }
+
+    void setTextColor(Color newColor) {
+        if (sameColor(color, newColor)) return;
+        color = newColor;
+        damageSelf();
+    }
+
+    Color getTextColor() {return color;}
+
+    void Draw(DrawList& list) override{
+        if (!visible) {return;}
+
+        // DrawText snaps to whole pixels too
+        Vector2 wp = getWorldPosition();
+        list.text(font.texture, getRun(), Vector2{(float)(int)wp.x, (float)(int)wp.y}, color);
+        Control::Draw(list);
+    }
+};
+
+// To get them label text related functions
+class TextElement {
+protected:
+    Label* label = nullptr;
+    virtual void onTextChanged() {}
+
+public:
+    void setText(std::string_view newText) {
+        if (label) {label -> setText(newText);}
+        onTextChanged();
+    }
+
+    void setTextInPlace(std::string_view newText, std::shared_ptr<const void> owner) {
+        if (label) {label -> setTextInPlace(newText, std::move(owner));}
+        onTextChanged();
+    }
+
+    std::string_view getText() const {
+        return label ? label -> getText() : std::string_view();
+    }
+
+    void setFontSize(int newFontSize) {
+        if (label) {label -> setFontSize(newFontSize);}
+    }
+
+    int getFontSize() {
+        return label ? label -> getFontSize() : 0;
+    }
+
+    int getTextSize() {
+        return label ? label -> getTextSize() : 0;
+    }
+
+    const Label* getLabel() const {return label;}
+
+    void setTextColor(Color newColor) {
+        if (label) {label -> setTextColor(newColor);}
+    }
+
+    Color getTextColor() {
+        return label ? label -> getTextColor() : BLACK;// return black if no color is set
+    }
+};
+
+
+// Used as a Background to hold Ui elements
+class Panel : public RectControl{
+    public:
+    // the look comes from the theme, only the fields set on this panel are its own
+    enum OverrideField : uint8_t {BgColor = 1, BorderColor = 2, BorderThickness = 4, AllFields = 7};
+
+    private:
+    StyleRole role = StyleRole::Panel;
+    uint8_t overrides = 0; // OverrideField bits
+    Style own = Style{BLANK, BLANK, Edges::All(0)}; // the overridden fields, not interned so animating a color costs nothing
+
+    Style resolveStyle() const {
+        Style style = getTheme().get(role);
+        if (overrides & BgColor) style.bgColor = own.bgColor;
+        if (overrides & BorderColor) style.borderColor = own.borderColor;
+        if (overrides & BorderThickness) style.borderThickness = own.borderThickness;
+        return style;
+    }
+
+    void setOverride(OverrideField field, const Style& values) {
+        if (field == BgColor) own.bgColor = values.bgColor;
+        if (field == BorderColor) own.borderColor = values.borderColor;
+        if (field == BorderThickness) own.borderThickness = values.borderThickness;
+        overrides |= field;
+    }
+
+    // the border is part of the layout, so it is kept in RectControl
+    void syncBorder() {
+        RectControl::setBorderThickness(resolveStyle().borderThickness);
+    }
+
+    protected:
+    void onThemeChanged() override {syncBorder();}
+
+    // Switches to another style of the theme, only repaints when the colors change
+    void setStyleRole(StyleRole newRole) {
+        if (role == newRole) return;
+        Style before = resolveStyle();
+        role = newRole;
+        Style after = resolveStyle();
+        if (!sameColor(before.bgColor, after.bgColor) || !sameColor(before.borderColor, after.borderColor))
+            damageSelf();
+        syncBorder();
+    }
+
+    public:
+    // panels clip what is inside of them
+    Panel() {
+        clipChildren = true;
+        syncBorder();
+    }
+
+    void setColor(Color newColor) {
+        Color old = getColor();
+        if ((overrides & BgColor) && sameColor(old, newColor)) return;
+        setOverride(BgColor, Style{newColor, BLANK, Edges::All(0)});
+        if (!sameColor(old, newColor)) damageSelf();
+    }
+
+    Color getColor() const {return resolveStyle().bgColor;}
+
+    void setBorderColor(Color newColor) {
+        Color old = getBorderColor();
+        if ((overrides & BorderColor) && sameColor(old, newColor)) return;
+        setOverride(BorderColor, Style{BLANK, newColor, Edges::All(0)});
+        if (!sameColor(old, newColor)) damageSelf();
+    }
+
+    Color getBorderColor() const {return resolveStyle().borderColor;}
+
+    using RectControl::setBorderThickness;
+    void setBorderThickness(const Edges& borderEdges) override {
+        if (!(overrides & BorderThickness) || border != borderEdges)
+            setOverride(BorderThickness, Style{BLANK, BLANK, borderEdges});
+        RectControl::setBorderThickness(borderEdges);
+    }
+
+    // The fields set on this panel (OverrideField bits) and the style holding them
+    uint8_t getStyleOverrides() const {return overrides;}
+    const Style& getOverrideStyle() const {return own;}
+
+    // Sets them all at once, for loading a saved look
+    void setStyleOverrides(uint8_t fields, const Style& style) {
+        overrides = fields & AllFields;
+        own = style;
+        damageSelf();
+        syncBorder();
+    }
+
+    // Back to the theme's look
+    void clearStyleOverrides() {
+        if (!overrides) return;
+        overrides = 0;
+        damageSelf();
+        syncBorder();
+    }
+
+    void Draw(DrawList& list) override {
+        if (!visible) {return;}
+
+        Rectangle outer = getOuterRect();
+        const Style& theme = getTheme().get(role);
+
+        // background ONLY
+        list.rect(outer, (overrides & BgColor) ? own.bgColor : theme.bgColor);
+
+        // border inside outer rect
+        list.border(outer, getBorder(), (overrides & BorderColor) ? own.borderColor : theme.borderColor);
+
+        Control::Draw(list);
+    }
+
+};
+
+// A button to press
+class Button : public Panel, public TextElement{
+private:
+    // States
+    bool hovered = false;
+    bool pressed = false;
+
+    std::function<void()> onClick;
+
+    // the styles come from the theme, a new border marks the layout dirty
+    void updateStyle() {
+        StyleRole newRole = StyleRole::Button;
+        if (hovered) {
+            newRole = pressed ? StyleRole::ButtonPressed : StyleRole::ButtonHover;
+        }
+        setStyleRole(newRole);
+    }
+
+protected:
+    bool arrangesChildren() const override {return true;}
+
+    void onLayout() override {
+        reCalcLayout();
+    }
+
+    Vector2 onMeasure(Vector2 available) override {
+        Vector2 textDim = label->measure(available);
+        Vector2 insets = getInsets();
+
+        // Avoid negative values
+        float minW = 30;
+        float minH = 30;
+        return Vector2{std::max(minW, textDim.x + insets.x), std::max(minH, textDim.y + insets.y)};
+    }
+
+public:
+    Button(std::string text) {
+
+        setPadding(Edges::All(6));
+
+        auto lbl = std::make_unique<Label>(std::move(text), 16);
+        label = lbl.get();
+        addChild(std::move(lbl));
+
+        setStyleRole(StyleRole::Button);
+        setHitTestable(true);
+    }
+
+    void setOnClick(std::function<void()> callback) {onClick = std::move(callback);}
+
+    void reCalcLayout() {
+        Vector2 textDim = label->getTextBounds();
+
+        // sized around the text unless a layout container gave us a size
+        if (!sizedByParent) {
+            Vector2 fit = measure(Vector2{Unbounded, Unbounded});
+            setSize(fit.x, fit.y);
+        }
+        float w = size.x;
+        float h = size.y;
+
+        // Use LOCAL coordinates
+        float localContentX = getPadding().left + getBorder().left;
+        float localContentY = getPadding().top  + getBorder().top;
+        float localContentW = w - (getPadding().left + getPadding().right) - (getBorder().left + getBorder().right);
+        float localContentH = h - (getPadding().top  + getPadding().bottom) - (getBorder().top  + getBorder().bottom);
+
+        // Centering text
+        float x = localContentX + (localContentW - textDim.x) / 2.0f;
+        float y = localContentY + (localContentH - textDim.y) / 2.0f;
+
+        label->setPosition((int)x, (int)y);
+    }
+
+
+    // The dispatcher keeps sending release to us while the mouse is held
+    void onPointerEnter() override {hovered = true; updateStyle();}
+    void onPointerLeave() override {hovered = false; updateStyle();}
+    void onPointerPress() override {pressed = true; updateStyle();}
+    void onPointerRelease() override {pressed = false; updateStyle();}
+    void onPointerClick() override {
+        if (onClick) onClick();
+    }
+
+    void Draw(DrawList& list) override {
+        Panel::Draw(list);
+    }
+
+};
+
+
+enum class FlexDirection {Row, Column};
+// where the children go on the main axis when there is space left
+enum class FlexJustify {Start, Center, End, SpaceBetween};
+// where the children go on the cross axis
+enum class FlexAlign {Start, Center, End, Stretch};
+
+// Lays its children out in a row or a column inside the content rect, margins included
+// children with a grow factor share the space left over and shrink when there is too little
+// it sizes itself around the children unless setSize() was called
+class FlexPanel : public Panel {
+    private:
+    FlexDirection direction = FlexDirection::Column;
+    FlexJustify justify = FlexJustify::Start;
+    FlexAlign align = FlexAlign::Start;
+    float gap = 0.0f;
+
+    struct Item {
+        Control* control;
+        Edges margin;
+        float main;
+        float cross;
+    };
+    std::vector<Item> items; // kept around so layouts do not allocate
+
+    // main axis is x in a row and y in a column
+    bool isRow() const {return direction == FlexDirection::Row;}
+    float mainOf(Vector2 v) const {return isRow() ? v.x : v.y;}
+    float crossOf(Vector2 v) const {return isRow() ? v.y : v.x;}
+    Vector2 fromAxes(float main, float cross) const {return isRow() ? Vector2{main, cross} : Vector2{cross, main};}
+    float mainStart(const Edges& e) const {return isRow() ? e.left : e.top;}
+    float mainEnd(const Edges& e) const {return isRow() ? e.right : e.bottom;}
+    float crossStart(const Edges& e) const {return isRow() ? e.top : e.left;}
+    float crossEnd(const Edges& e) const {return isRow() ? e.bottom : e.right;}
+
+    // visible children with the size they want in the given content space
+    void measureItems(Vector2 inner) {
+        items.clear();
+        for (Control* child = firstChild; child; child = child->getNextSibling()) {
+            if (!child->isVisible()) continue;
+            Vector2 s = child -> measure(inner);
+            items.push_back(Item{child, child->getLayoutMargin(), mainOf(s), crossOf(s)});
+        }
+    }
+
+    protected:
+    // grow and shrink are ignored (StackPanel)
+    bool flexible = true;
+
+    bool arrangesChildren() const override {return true;}
+
+    Vector2 onMeasure(Vector2 available) override {
+        Vector2 insets = getInsets();
+        measureItems(Vector2{std::max(0.0f, available.x - insets.x), std::max(0.0f, available.y - insets.y)});
+
+        float main = 0, cross = 0;
+        for (const Item& item : items) {
+            main += mainStart(item.margin) + item.main + mainEnd(item.margin);
+            cross = std::max(cross, crossStart(item.margin) + item.cross + crossEnd(item.margin));
+        }
+        if (items.size() > 1) main += gap * (items.size() - 1);
+
+        // a size set with setSize() wins over the size of the children
+        Vector2 content = fromAxes(main, cross);
+        return Vector2{
+            preferredSize.x > 0 ? preferredSize.x : content.x + insets.x,
+            preferredSize.y > 0 ? preferredSize.y : content.y + insets.y
+        };
+    }
+
+    void onLayout() override {
+        // sized around the children unless a layout container or setSize() did it
+        if (!sizedByParent && (preferredSize.x <= 0 || preferredSize.y <= 0)) {
+            Vector2 fit = measure(Vector2{Unbounded, Unbounded});
+            Vector2 newSize = Vector2{std::floor(fit.x), std::floor(fit.y)};
+            if (newSize.x != size.x || newSize.y != size.y) resize(newSize);
+        }
+
+        Rectangle content = getLocalContentRect();
+        float availMain = isRow() ? content.width : content.height;
+        float availCross = isRow() ? content.height : content.width;
+        measureItems(Vector2{content.width, content.height});
+        if (items.empty()) return;
+
+        float used = gap * (items.size() - 1);
+        float growTotal = 0, shrinkTotal = 0;
+        for (const Item& item : items) {
+            used += mainStart(item.margin) + item.main + mainEnd(item.margin);
+            growTotal += item.control->getFlexGrow();
+            shrinkTotal += item.control->getFlexShrink() * item.main;
+        }
+
+        // hand out the free space, or take back what is missing
+        float free = availMain - used;
+        if (flexible && free > 0 && growTotal > 0) {
+            for (Item& item : items) item.main += free * item.control->getFlexGrow() / growTotal;
+            free = 0;
+        }
+        else if (flexible && free < 0 && shrinkTotal > 0) {
+            for (Item& item : items)
+                item.main = std::max(0.0f, item.main + free * item.control->getFlexShrink() * item.main / shrinkTotal);
+            free = 0;
+        }
+
+        float cursor = 0;
+        float between = gap;
+        if (free > 0) {
+            if (justify == FlexJustify::Center) cursor = free / 2;
+            else if (justify == FlexJustify::End) cursor = free;
+            else if (justify == FlexJustify::SpaceBetween && items.size() > 1) between += free / (items.size() - 1);
+        }
+
+        for (const Item& item : items) {
+            float crossMargins = crossStart(item.margin) + crossEnd(item.margin);
+            float crossSize = align == FlexAlign::Stretch ? std::max(0.0f, availCross - crossMargins) : item.cross;
+            float crossPos = crossStart(item.margin);
+            if (align == FlexAlign::Center) crossPos += (availCross - crossMargins - crossSize) / 2;
+            else if (align == FlexAlign::End) crossPos = availCross - crossEnd(item.margin) - crossSize;
+
+            cursor += mainStart(item.margin);
+            Vector2 pos = fromAxes(cursor, crossPos);
+            Vector2 itemSize = fromAxes(item.main, crossSize);
+            item.control -> setPosition((int)(content.x + pos.x), (int)(content.y + pos.y));
+            item.control -> arrange((int)itemSize.x, (int)itemSize.y);
+            cursor += item.main + mainEnd(item.margin) + between;
+        }
+    }
+
+    public:
+    explicit FlexPanel(FlexDirection newDirection = FlexDirection::Column)
+    : direction(newDirection) {
+    }
+
+    void setDirection(FlexDirection newDirection) {
+        if (direction == newDirection) return;
+        direction = newDirection;
+        markLayoutDirty();
+    }
+    FlexDirection getDirection() const {return direction;}
+
+    void setJustify(FlexJustify newJustify) {
+        if (justify == newJustify) return;
+        justify = newJustify;
+        markLayoutDirty();
+    }
+    FlexJustify getJustify() const {return justify;}
+
+    void setAlign(FlexAlign newAlign) {
+        if (align == newAlign) return;
+        align = newAlign;
+        markLayoutDirty();
+    }
+    FlexAlign getAlign() const {return align;}
+
+    // space between two children, on top of their margins
+    void setGap(float newGap) {
+        if (gap == newGap) return;
+        gap = newGap;
+        markLayoutDirty();
+    }
+    float getGap() const {return gap;}
+};
+
+// Puts its children one after the other, at the size they ask for
+class StackPanel : public FlexPanel {
+    public:
+    explicit StackPanel(FlexDirection newDirection = FlexDirection::Column, float newGap = 0.0f)
+    : FlexPanel(newDirection) {
+        flexible = false;
+        setGap(newGap);
+    }
+};
+
+
+// Prefix sums over row heights (a Fenwick tree) to find rows by offset
+// with a fixed height nothing is stored at all
+class RowHeightIndex {
+    private:
+    std::vector<double> tree; // 1 based, empty when the height is fixed
+    size_t count = 0;
+    float fixedHeight = 20.0f;
+
+    public:
+    void setFixed(size_t newCount, float height) {
+        tree.clear();
+        tree.shrink_to_fit();
+        count = newCount;
+        fixedHeight = height;
+    }
+
+    void setVariable(size_t newCount, const std::function<float(size_t)>& heightOf) {
+        count = newCount;
+        tree.assign(count + 1, 0.0);
+        for (size_t i = 1; i <= count; i++) {
+            tree[i] += heightOf(i - 1);
+            size_t up = i + (i & (~i + 1));
+            if (up <= count) tree[up] += tree[i];
+        }
+    }
+
+    bool isFixed() const {return tree.empty();}
+    size_t size() const {return count;}
+
+    // Sum of the heights of the rows before index
+    double offsetOf(size_t index) const {
+        if (isFixed()) return (double)index * fixedHeight;
+        double sum = 0.0;
+        for (size_t i = std::min(index, count); i > 0; i -= i & (~i + 1))
+            sum += tree[i];
+        return sum;
+    }
+
+    float heightOf(size_t index) const {
+        if (isFixed()) return fixedHeight;
+        return (float)(offsetOf(index + 1) - offsetOf(index));
+    }
+
+    void setHeight(size_t index, float height) {
+        if (isFixed() || index >= count) return;
+        double change = height - heightOf(index);
+        for (size_t i = index + 1; i <= count; i += i & (~i + 1))
+            tree[i] += change;
+    }
+
+    double totalHeight() const {return offsetOf(count);}
+
+    // The row at the offset, clamped to the last row
+    size_t indexAt(double offset) const {
+        if (count == 0 || offset <= 0.0) return 0;
+        if (isFixed()) {
+            if (fixedHeight <= 0.0f) return 0;
+            return std::min(count - 1, (size_t)(offset / fixedHeight));
+        }
+        size_t pos = 0;
+        size_t step = 1;
+        while (step * 2 <= count) step *= 2;
+        for (; step > 0; step /= 2) {
+            if (pos + step <= count && tree[pos + step] <= offset) {
+                pos += step;
+                offset -= tree[pos];
+            }
+        }
+        return std::min(count - 1, pos);
+    }
+};
+
+// Scrolling list that only has controls for the rows that can be seen
+// rows are made by the row factory and filled in by the bind callback,
+// rows that scroll out of view are reused for the ones scrolling in
+class ListView : public Panel {
+    private:
+    size_t itemCount = 0;
+    RowHeightIndex heights;
+    std::function<float(size_t)> rowHeightOf;
+
+    std::function<ControlPtr()> makeRow;
+    std::function<void(Control& row, size_t index)> bindRow;
+
+    // rows for the items [firstRow, firstRow + rows.size())
+    std::vector<Control*> rows;
+    std::vector<Control*> spareRows;
+    std::vector<Control*> nextRows; // scratch space for updateRows()
+    size_t firstRow = 0;
+    bool rebindAll = false;
+
+    // smooth scrolling, the offset eases towards the target
+    double scrollOffset = 0.0;
+    double scrollTarget = 0.0;
+    float wheelStep = 60.0f;
+    float scrollSpeed = 14.0f;
+
+    Color scrollbarColor = Color{0, 0, 0, 80};
+
+    double maxScroll() {
+        return std::max(0.0, heights.totalHeight() - getLocalContentRect().height);
+    }
+
+    void clampScroll() {
+        scrollTarget = std::clamp(scrollTarget, 0.0, maxScroll());
+        scrollOffset = std::clamp(scrollOffset, 0.0, maxScroll());
+    }
+
+    Control* takeRow() {
+        if (!spareRows.empty()) {
+            Control* row = spareRows.back();
+            spareRows.pop_back();
+            row -> setVisibility(true);
+            return row;
+        }
+        ControlPtr row = makeRow ? makeRow() : ControlPtr(std::make_unique<Label>("", 16));
+        Control* added = row.get();
+        addChild(std::move(row));
+        return added;
+    }
+
+    void releaseRow(Control* row) {
+        row -> setVisibility(false);
+        spareRows.push_back(row);
+    }
+
+    // Makes sure the visible items have rows and puts them in place
+    void updateRows() {
+        Rectangle content = getLocalContentRect();
+        size_t newFirst = 0;
+        size_t newCount = 0;
+        if (itemCount > 0 && content.height > 0) {
+            newFirst = heights.indexAt(scrollOffset);
+            size_t last = heights.indexAt(scrollOffset + content.height);
+            newCount = last - newFirst + 1;
+        }
+
+        nextRows.assign(newCount, nullptr);
+        for (size_t i = 0; i < rows.size(); i++) {
+            size_t index = firstRow + i;
+            if (!rebindAll && index >= newFirst && index < newFirst + newCount) nextRows[index - newFirst] = rows[i];
+            else releaseRow(rows[i]);
+        }
+        for (size_t i = 0; i < newCount; i++) {
+            if (nextRows[i]) continue;
+            nextRows[i] = takeRow();
+            if (bindRow) bindRow(*nextRows[i], newFirst + i);
+        }
+        rows.swap(nextRows);
+        firstRow = newFirst;
+        rebindAll = false;
+
+        for (size_t i = 0; i < rows.size(); i++) {
+            size_t index = firstRow + i;
+            double y = content.y + heights.offsetOf(index) - scrollOffset;
+            rows[i] -> setPosition((int)content.x, (int)std::floor(y));
+            if (RectControl* rect = rows[i]->asRectControl())
+                rect -> setSize((int)content.width, (int)heights.heightOf(index));
+        }
+    }
+
+    protected:
+    void onLayout() override {
+        clampScroll();
+        updateRows();
+    }
+
+    public:
+    ListView() {
+        setHitTestable(true);
+    }
+
+    // Rows come from here, plain labels are used when it is not set
+    void setRowFactory(std::function<ControlPtr()> factory) {
+        makeRow = std::move(factory);
+        for (Control* row : rows) removeChild(row);
+        for (Control* row : spareRows) removeChild(row);
+        rows.clear();
+        spareRows.clear();
+        markLayoutDirty();
+    }
+
+    // Fills a row in with an item, called when a row starts showing another item
+    void setBindRow(std::function<void(Control& row, size_t index)> bind) {
+        bindRow = std::move(bind);
+        refresh();
+    }
+
+    void setItemCount(size_t count) {
+        itemCount = count;
+        if (rowHeightOf) heights.setVariable(count, rowHeightOf);
+        else heights.setFixed(count, heights.heightOf(0));
+        refresh();
+    }
+    size_t getItemCount() const {return itemCount;}
+
+    // Every row has the same height
+    void setRowHeight(float height) {
+        rowHeightOf = nullptr;
+        heights.setFixed(itemCount, height);
+        refresh();
+    }
+
+    // Rows ask for their own height, this keeps a prefix sum over all items
+    void setRowHeights(std::function<float(size_t)> heightOf) {
+        rowHeightOf = std::move(heightOf);
+        heights.setVariable(itemCount, rowHeightOf);
+        refresh();
+    }
+
+    // Call when one item's height changed, only works with setRowHeights()
+    void updateRowHeight(size_t index) {
+        if (!rowHeightOf || index >= itemCount) return;
+        heights.setHeight(index, rowHeightOf(index));
+        markLayoutDirty();
+    }
+
+    // Bind every visible row again, for when the data changed
+    void refresh() {
+        rebindAll = true;
+        markLayoutDirty();
+    }
+
+    void scrollTo(double offset, bool smooth = true) {
+        scrollTarget = std::clamp(offset, 0.0, maxScroll());
+        if (!smooth) {
+            scrollOffset = scrollTarget;
+            markLayoutDirty();
+        }
+    }
+    void scrollBy(double amount) {scrollTo(scrollTarget + amount);}
+    void scrollToItem(size_t index, bool smooth = true) {scrollTo(heights.offsetOf(index), smooth);}
+    double getScrollOffset() const {return scrollOffset;}
+
+    void setWheelStep(float step) {wheelStep = step;}
+    void setScrollSpeed(float speed) {scrollSpeed = speed;}
+
+    bool onPointerWheel(float amount) override {
+        scrollBy(-amount * wheelStep);
+        return true;
+    }
+
+    void Update() override {
+        if (scrollOffset != scrollTarget) {
+            double step = (scrollTarget - scrollOffset) * std::min(1.0f, GetFrameTime() * scrollSpeed);
+            if (std::fabs(scrollTarget - scrollOffset) < 0.5) scrollOffset = scrollTarget;
+            else scrollOffset += step;
+            markLayoutDirty();
+            damageSelf(); // for the scrollbar
+        }
+        Panel::Update();
+    }
+
+    void Draw(DrawList& list) override {
+        if (!visible) {return;}
+        Panel::Draw(list);
+
+        // scrollbar thumb
+        double total = heights.totalHeight();
+        Rectangle content = getContentRect();
+        if (total > content.height && content.height > 0) {
+            float thumbH = std::max(16.0f, (float)(content.height * content.height / total));
+            float thumbY = content.y + (float)(scrollOffset / maxScroll()) * (content.height - thumbH);
+            list.rect(Rectangle{content.x + content.width - 6, thumbY, 4, thumbH}, scrollbarColor);
+        }
+    }
+};
+
+
+// ========================================================
+// Text documents
+//
+
+// A read only file mapped into memory, pages are only read once they are touched
+class MappedFile {
+    private:
+    void* data = nullptr;
+    size_t length = 0;
+
+    public:
+    MappedFile() = default;
+    ~MappedFile() {close();}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const char* path) {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            TraceLog(LOG_WARNING, "FILEIO: [%s] Failed to open file", path);
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            TraceLog(LOG_WARNING, "FILEIO: [%s] Failed to read file size", path);
+            return false;
+        }
+        length = (size_t)info.st_size;
+        if (length > 0) {
+            data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                data = nullptr;
+                length = 0;
+                ::close(fd);
+                TraceLog(LOG_WARNING, "FILEIO: [%s] Failed to map file", path);
+                return false;
+            }
+        }
+        ::close(fd); // the mapping keeps the file open
+        return true;
+    }
+
+    void close() {
+        if (data) munmap(data, length);
+        data = nullptr;
+        length = 0;
+    }
+
+    std::string_view view() const {return std::string_view((const char*)data, length);}
+    size_t size() const {return length;}
+};
+
+// Text as a list of pieces of the original text and of an append only buffer
+// an edit only splits a piece, the original text is never copied. The pieces
+// are kept in a treap ordered by position, every node knows how many bytes its
+// subtree holds, so finding an offset takes log(pieces) however long the session
+class PieceTable {
+    private:
+    struct Piece {
+        bool added;    // from the added buffer, otherwise from the original
+        size_t start;
+        size_t length;
+    };
+
+    // 0 is the empty tree, nodes[0] is never used
+    struct Node {
+        Piece piece;
+        size_t bytes;   // of the whole subtree
+        uint32_t left;
+        uint32_t right;
+        uint32_t priority; // higher ones are closer to the root
+    };
+
+    std::string_view original; // kept alive by the owner (a MappedFile or a string)
+    std::string added;
+    std::vector<Node> nodes = std::vector<Node>(1);
+    std::vector<uint32_t> freeNodes;
+    uint32_t root = 0;
+    uint32_t seed = 2463534242u;
+    size_t pieceCount = 0;
+
+    const char* piecePointer(const Piece& p) const {
+        return (p.added ? added.data() : original.data()) + p.start;
+    }
+
+    size_t bytesOf(uint32_t t) const {return t ? nodes[t].bytes : 0;}
+
+    void update(uint32_t t) {
+        Node& node = nodes[t];
+        node.bytes = bytesOf(node.left) + node.piece.length + bytesOf(node.right);
+    }
+
+    uint32_t newNode(const Piece& piece) {
+        // xorshift, the priorities only have to look random
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        uint32_t t;
+        if (!freeNodes.empty()) {
+            t = freeNodes.back();
+            freeNodes.pop_back();
+        }
+        else {
+            t = (uint32_t)nodes.size();
+            nodes.emplace_back();
+        }
+        nodes[t] = Node{piece, piece.length, 0, 0, seed};
+        pieceCount++;
+        return t;
+    }
+
+    void freeTree(uint32_t t) {
+        if (!t) return;
+        freeTree(nodes[t].left);
+        freeTree(nodes[t].right);
+        freeNodes.push_back(t);
+        pieceCount--;
+    }
+
+    // l gets the first offset bytes of t, r the rest, a piece across offset is cut in two
+    void split(uint32_t t, size_t offset, uint32_t& l, uint32_t& r) {
+        if (!t) {
+            l = r = 0;
+            return;
+        }
+        size_t leftBytes = bytesOf(nodes[t].left);
+        size_t pieceEnd = leftBytes + nodes[t].piece.length;
+        uint32_t a, b;
+        if (offset <= leftBytes) {
+            split(nodes[t].left, offset, a, b);
+            nodes[t].left = b;
+            update(t);
+            l = a;
+            r = t;
+        }
+        else if (offset >= pieceEnd) {
+            split(nodes[t].right, offset - pieceEnd, a, b);
+            nodes[t].right = a;
+            update(t);
+            l = t;
+            r = b;
+        }
+        else {
+            size_t inside = offset - leftBytes;
+            Piece tail = nodes[t].piece;
+            tail.start += inside;
+            tail.length -= inside;
+            uint32_t tailNode = newNode(tail); // can move nodes, no references kept across it
+            uint32_t right = nodes[t].right;
+            nodes[t].piece.length = inside;
+            nodes[t].right = 0;
+            update(t);
+            l = t;
+            r = merge(tailNode, right);
+        }
+    }
+
+    uint32_t merge(uint32_t a, uint32_t b) {
+        if (!a) return b;
+        if (!b) return a;
+        if (nodes[a].priority > nodes[b].priority) {
+            uint32_t right = merge(nodes[a].right, b);
+            nodes[a].right = right;
+            update(a);
+            return a;
+        }
+        uint32_t left = merge(a, nodes[b].left);
+        nodes[b].left = left;
+        update(b);
+        return b;
+    }
+
+    // grows the piece ending at offset when it is the end of the added buffer
+    bool growEnd(uint32_t t, size_t offset, std::string_view text) {
+        if (!t) return false;
+        size_t leftBytes = bytesOf(nodes[t].left);
+        Piece& piece = nodes[t].piece;
+        bool grown;
+        if (offset <= leftBytes) grown = growEnd(nodes[t].left, offset, text);
+        else if (offset == leftBytes + piece.length) {
+            grown = piece.added && piece.start + piece.length == added.size();
+            if (grown) {
+                added.append(text);
+                piece.length += text.size();
+            }
+        }
+        else if (offset < leftBytes + piece.length) grown = false;
+        else grown = growEnd(nodes[t].right, offset - leftBytes - piece.length, text);
+        if (grown) nodes[t].bytes += text.size();
+        return grown;
+    }
+
+    template <typename Visit>
+    void visitRange(uint32_t t, size_t offset, size_t& length, Visit& visit) const {
+        while (t && length > 0) {
+            const Node& node = nodes[t];
+            size_t leftBytes = bytesOf(node.left);
+            if (offset < leftBytes) visitRange(node.left, offset, length, visit);
+            if (length == 0) return;
+            size_t pieceEnd = leftBytes + node.piece.length;
+            if (offset < pieceEnd) {
+                size_t inside = offset > leftBytes ? offset - leftBytes : 0;
+                size_t n = std::min(length, node.piece.length - inside);
+                visit(piecePointer(node.piece) + inside, n);
+                length -= n;
+            }
+            offset = offset > pieceEnd ? offset - pieceEnd : 0;
+            t = node.right;
+        }
+    }
+
+    public:
+    void reset(std::string_view text) {
+        original = text;
+        added.clear();
+        nodes.resize(1);
+        freeNodes.clear();
+        pieceCount = 0;
+        root = text.empty() ? 0 : newNode(Piece{false, 0, text.size()});
+    }
+
+    size_t size() const {return bytesOf(root);}
+
+    void insert(size_t offset, std::string_view text) {
+        if (text.empty()) return;
+        offset = std::min(offset, size());
+
+        // typing at the end of the last insert just grows that piece
+        if (offset > 0 && growEnd(root, offset, text)) return;
+
+        uint32_t piece = newNode(Piece{true, added.size(), text.size()});
+        added.append(text);
+        uint32_t l, r;
+        split(root, offset, l, r);
+        root = merge(merge(l, piece), r);
+    }
+
+    void erase(size_t offset, size_t length) {
+        if (offset >= size()) return;
+        length = std::min(length, size() - offset);
+        if (length == 0) return;
+        uint32_t l, middle, r;
+        split(root, offset, l, r);
+        split(r, length, middle, r);
+        freeTree(middle);
+        root = merge(l, r);
+    }
+
+    // Calls visit(pointer, length) for the pieces of [offset, offset + length)
+    template <typename Visit>
+    void forEachChunk(size_t offset, size_t length, Visit&& visit) const {
+        visitRange(root, offset, length, visit);
+    }
+
+    void copy(size_t offset, size_t length, std::string& out) const {
+        out.clear();
+        forEachChunk(offset, length, [&](const char* p, size_t n) {out.append(p, n);});
+    }
+
+    size_t getPieceCount() const {return pieceCount;}
+};
+
+// Where the lines of a document start, kept in blocks of lines so an edit
+// only scans the blocks it touched again. Also keeps how many wrapped rows
+// every line takes, 0 until the line was wrapped
+class LineIndex {
+    private:
+    static constexpr size_t blockLines = 1024;
+
+    struct Block {
+        size_t bytes = 0;
+        std::vector<uint32_t> starts; // relative to the block, the first one is 0
+        std::vector<uint16_t> rows;
+        unsigned rowsVersion = 0;
+    };
+
+    std::vector<Block> blocks;
+    std::vector<size_t> firstLine; // of every block
+    std::vector<size_t> firstByte;
+    unsigned rowsVersion = 0;
+
+    // scratch space for edit(), kept so typing does not allocate
+    std::vector<Block> scanned;
+    std::vector<Block> spareBlocks; // replaced ones, their vectors are reused
+    std::vector<uint16_t> oldRows;
+
+    void addBlock(std::vector<Block>& out) {
+        if (spareBlocks.empty()) out.emplace_back();
+        else {
+            out.push_back(std::move(spareBlocks.back()));
+            spareBlocks.pop_back();
+        }
+        out.back().starts.clear();
+        out.back().starts.push_back(0);
+    }
+
+    // Splits [offset, offset + length) into blocks, the range has to start at a line start
+    void scan(const PieceTable& text, size_t offset, size_t length, std::vector<Block>& out) {
+        addBlock(out);
+        size_t pos = 0;       // inside the range
+        size_t blockBase = 0; // where the current block starts inside the range
+        bool atEnd = offset + length == text.size(); // otherwise a break at the end starts the next block
+        text.forEachChunk(offset, length, [&](const char* p, size_t n) {
+            const char* end = p + n;
+            const char* cursor = p;
+            while (const char* nl = (const char*)std::memchr(cursor, '\n', end - cursor)) {
+                size_t lineStart = pos + (nl - p) + 1;
+                if (lineStart == length && !atEnd) break;
+                if (out.back().starts.size() >= blockLines) {
+                    out.back().bytes = lineStart - blockBase;
+                    blockBase = lineStart;
+                    addBlock(out);
+                }
+                else out.back().starts.push_back((uint32_t)(lineStart - blockBase));
+                cursor = nl + 1;
+            }
+            pos += n;
+        });
+        out.back().bytes = length - blockBase;
+        for (Block& b : out) {
+            b.rows.assign(b.starts.size(), 0);
+            b.rowsVersion = rowsVersion;
+        }
+    }
+
+    void updatePrefix(size_t from) {
+        firstLine.resize(blocks.size());
+        firstByte.resize(blocks.size());
+        for (size_t b = from; b < blocks.size(); b++) {
+            firstLine[b] = b == 0 ? 0 : firstLine[b - 1] + blocks[b - 1].starts.size();
+            firstByte[b] = b == 0 ? 0 : firstByte[b - 1] + blocks[b - 1].bytes;
+        }
+    }
+
+    size_t blockOfLine(size_t line) const {
+        return std::upper_bound(firstLine.begin(), firstLine.end(), line) - firstLine.begin() - 1;
+    }
+    size_t blockOfByte(size_t offset) const {
+        size_t b = std::upper_bound(firstByte.begin(), firstByte.end(), offset) - firstByte.begin() - 1;
+        return std::min(b, blocks.size() - 1);
+    }
+
+    Block& rowBlock(size_t b) {
+        Block& block = blocks[b];
+        if (block.rowsVersion != rowsVersion) {
+            std::fill(block.rows.begin(), block.rows.end(), 0);
+            block.rowsVersion = rowsVersion;
+        }
+        return block;
+    }
+
+    public:
+    void build(const PieceTable& text) {
+        blocks.clear();
+        scan(text, 0, text.size(), blocks);
+        updatePrefix(0);
+    }
+
+    size_t lineCount() const {return firstLine.back() + blocks.back().starts.size();}
+    size_t getBlockCount() const {return blocks.size();}
+
+    size_t lineStart(size_t line) const {
+        size_t b = blockOfLine(line);
+        return firstByte[b] + blocks[b].starts[line - firstLine[b]];
+    }
+
+    // without the line break, the last line never has one
+    size_t lineLength(size_t line, const PieceTable& text) const {
+        size_t end = line + 1 < lineCount() ? lineStart(line + 1) - 1 : text.size();
+        return end - lineStart(line);
+    }
+
+    size_t lineAt(size_t offset) const {
+        size_t b = blockOfByte(offset);
+        const std::vector<uint32_t>& starts = blocks[b].starts;
+        size_t i = std::upper_bound(starts.begin(), starts.end(), (uint32_t)(offset - firstByte[b])) - starts.begin() - 1;
+        return firstLine[b] + i;
+    }
+
+    uint16_t getRows(size_t line) {
+        size_t b = blockOfLine(line);
+        return rowBlock(b).rows[line - firstLine[b]];
+    }
+    void setRows(size_t line, uint16_t rows) {
+        size_t b = blockOfLine(line);
+        rowBlock(b).rows[line - firstLine[b]] = rows;
+    }
+    // every line has to be wrapped again, done lazily one block at a time
+    void resetRows() {rowsVersion++;}
+
+    // [offset, offset + removed) was replaced with added bytes, call after editing the text
+    // the row counts of the lines around the edit are kept
+    void edit(const PieceTable& text, size_t offset, size_t removed, size_t added) {
+        size_t b0 = blockOfByte(offset);
+        size_t b1 = blockOfByte(offset + removed);
+        size_t startLine = lineAt(offset);
+        size_t endLine = lineAt(offset + removed);
+        size_t linesBefore = startLine - firstLine[b0];
+        size_t linesAfter = firstLine[b1] + blocks[b1].starts.size() - 1 - endLine;
+
+        oldRows.clear();
+        for (size_t b = b0; b <= b1; b++) {
+            Block& block = rowBlock(b);
+            oldRows.insert(oldRows.end(), block.rows.begin(), block.rows.end());
+        }
+
+        size_t rangeStart = firstByte[b0];
+        size_t rangeLength = firstByte[b1] + blocks[b1].bytes - rangeStart - removed + added;
+        scanned.clear();
+        scan(text, rangeStart, rangeLength, scanned);
+
+        size_t newLines = 0;
+        for (const Block& b : scanned) newLines += b.starts.size();
+        size_t line = 0;
+        for (Block& b : scanned) {
+            for (uint16_t& rows : b.rows) {
+                if (line < linesBefore) rows = oldRows[line];
+                else if (line >= newLines - linesAfter) rows = oldRows[oldRows.size() - (newLines - line)];
+                line++;
+            }
+        }
+
+        // swap the new blocks in, the old ones go to the spares
+        size_t count = b1 - b0 + 1;
+        size_t common = std::min(count, scanned.size());
+        for (size_t i = 0; i < common; i++) std::swap(blocks[b0 + i], scanned[i]);
+        if (scanned.size() > count)
+            blocks.insert(blocks.begin() + b1 + 1, std::make_move_iterator(scanned.begin() + common), std::make_move_iterator(scanned.end()));
+        else if (count > common) {
+            for (size_t b = b0 + common; b <= b1; b++) spareBlocks.push_back(std::move(blocks[b]));
+            blocks.erase(blocks.begin() + b0 + common, blocks.begin() + b1 + 1);
+        }
+        for (size_t i = 0; i < common && spareBlocks.size() < 4; i++) spareBlocks.push_back(std::move(scanned[i]));
+        updatePrefix(b0);
+    }
+
+};
+
+// Scrolling view over a big document (logs, config files) that can be edited
+// the text is a piece table over the file, lines are wrapped when they come
+// into view and only the visible rows are measured and drawn, the lines on
+// screen stay wrapped and measured until an edit touches them
+class TextArea : public Panel {
+    private:
+    MappedFile file;
+    std::string ownedText;
+    PieceTable text;
+    LineIndex lines;
+
+    Font font = getDefaultFont();
+    int fontSize = 16;
+    Color textColor = BLACK;
+    bool wrap = true;
+
+    // first visible row, a line and a wrapped row of it
+    size_t topLine = 0;
+    size_t topRow = 0;
+    float wheelRows = 3.0f;
+
+    float wrapWidth = -1.0f; // width the row counts are for
+
+    // wrapped and shaped lines seen in the last layouts, kept out of the shared TextCache
+    // an edit only drops the lines it touched, the ones after it are renumbered
+    struct ShapedLine {
+        size_t line = SIZE_MAX; // SIZE_MAX when the slot is free
+        unsigned seen = 0;      // layout that last showed it
+        std::vector<uint32_t> breaks;
+        std::vector<TextRun> rows;       // only the ones shown so far are shaped
+        std::vector<uint8_t> rowShaped;
+        size_t rowCount() const {return breaks.size() + 1;}
+    };
+    std::vector<ShapedLine> shapedLines;
+    unsigned layoutCount = 0;
+
+    struct VisibleRow {
+        float y; // relative to the content rect
+        uint32_t slot;
+        uint32_t row;
+    };
+    std::vector<VisibleRow> visibleRows;
+
+    // scratch space
+    std::string lineText;
+    std::string rowText;
+    std::vector<uint32_t> breaks;
+
+    Color scrollbarColor = Color{0, 0, 0, 80};
+
+    float drawFontSize() const {return (float)std::max(fontSize, 10);}
+    float drawSpacing() const {return (float)(std::max(fontSize, 10)/10);}
+    float rowHeight() const {return drawFontSize() + 2.0f;}
+
+    float advanceOf(int codepoint) const {
+        int index = GetGlyphIndex(font, codepoint);
+        float scale = drawFontSize() / font.baseSize;
+        const GlyphInfo& glyph = font.glyphs[index];
+        if (glyph.advanceX == 0) return font.recs[index].width*scale + drawSpacing();
+        return glyph.advanceX*scale + drawSpacing();
+    }
+
+    // Where the rows after the first one start, breaks after spaces when it can
+    void wrapLine(const std::string& line, std::vector<uint32_t>& out) const {
+        out.clear();
+        if (!wrap || wrapWidth <= 0 || !font.glyphs || font.baseSize <= 0) return;
+        float x = 0.0f;     // width of the row so far
+        float wordX = 0.0f; // width since the last space
+        size_t rowStart = 0;
+        size_t wordStart = 0;
+        for (size_t i = 0; i < line.size();) {
+            int bytes = 0;
+            int codepoint = GetCodepointNext(line.c_str() + i, &bytes);
+            bytes = std::max(bytes, 1);
+            float w = advanceOf(codepoint);
+            if (x + w > wrapWidth && i > rowStart) {
+                if (wordStart > rowStart) {
+                    rowStart = wordStart;
+                    x = wordX;
+                }
+                else {
+                    rowStart = i;
+                    x = 0.0f;
+                    wordX = 0.0f;
+                }
+                out.push_back((uint32_t)rowStart);
+            }
+            x += w;
+            wordX += w;
+            i += bytes;
+            if (codepoint == ' ') {
+                wordStart = i;
+                wordX = 0.0f;
+            }
+        }
+    }
+
+    void readLine(size_t line) {
+        text.copy(lines.lineStart(line), lines.lineLength(line, text), lineText);
+        if (!lineText.empty() && lineText.back() == '\r') lineText.pop_back();
+    }
+
+    // wrapped rows of a line, wraps it the first time
+    size_t rowsOf(size_t line) {
+        uint16_t rows = lines.getRows(line);
+        if (rows == 0) {
+            readLine(line);
+            wrapLine(lineText, breaks);
+            rows = (uint16_t)std::min<size_t>(breaks.size() + 1, UINT16_MAX);
+            lines.setRows(line, rows);
+        }
+        return rows;
+    }
+
+    void textChanged() {
+        topLine = std::min(topLine, lines.lineCount() - 1);
+        markLayoutDirty();
+        damageSelf();
+    }
+
+    void dropShapedLines() {
+        for (ShapedLine& shaped : shapedLines) shaped.line = SIZE_MAX;
+    }
+
+    // Lines [first, last] were replaced by [first, newLast], call after lines.edit()
+    void shapedLinesEdited(size_t first, size_t last, size_t newLast) {
+        for (ShapedLine& shaped : shapedLines) {
+            if (shaped.line == SIZE_MAX || shaped.line < first) continue;
+            if (shaped.line <= last) shaped.line = SIZE_MAX;
+            else shaped.line = shaped.line - last + newLast;
+        }
+    }
+
+    // Slot holding the line wrapped, reuses one that is not on screen otherwise
+    uint32_t shapedLine(size_t line, size_t viewEnd) {
+        uint32_t slot = UINT32_MAX;
+        for (uint32_t i = 0; i < shapedLines.size(); i++) {
+            const ShapedLine& shaped = shapedLines[i];
+            if (shaped.line == line) {
+                shapedLines[i].seen = layoutCount;
+                return i;
+            }
+            // a line further down might still be shown in this layout
+            bool maybeShown = shaped.line >= line && shaped.line < viewEnd;
+            if (slot == UINT32_MAX && shaped.seen != layoutCount && !maybeShown) slot = i;
+        }
+        if (slot == UINT32_MAX) {
+            slot = (uint32_t)shapedLines.size();
+            shapedLines.emplace_back();
+        }
+
+        ShapedLine& shaped = shapedLines[slot];
+        shaped.line = line;
+        shaped.seen = layoutCount;
+        readLine(line);
+        wrapLine(lineText, shaped.breaks);
+        lines.setRows(line, (uint16_t)std::min<size_t>(shaped.rowCount(), UINT16_MAX));
+        if (shaped.rows.size() < shaped.rowCount()) shaped.rows.resize(shaped.rowCount());
+        shaped.rowShaped.assign(shaped.rowCount(), 0);
+        return slot;
+    }
+
+    // Shapes a row of a wrapped line the first time it is shown
+    void shapeRow(ShapedLine& shaped, size_t row) {
+        if (shaped.rowShaped[row]) return;
+        size_t start = row == 0 ? 0 : shaped.breaks[row - 1];
+        size_t end = row < shaped.breaks.size() ? shaped.breaks[row] : lines.lineLength(shaped.line, text);
+        text.copy(lines.lineStart(shaped.line) + start, end - start, rowText);
+        if (row == shaped.breaks.size() && !rowText.empty() && rowText.back() == '\r') rowText.pop_back();
+        TextCache::shape(font, drawFontSize(), drawSpacing(), rowText, shaped.rows[row]);
+        shaped.rowShaped[row] = 1;
+        uiStats.textMeasurements++;
+    }
+
+    protected:
+    void onLayout() override {
+        Rectangle content = getLocalContentRect();
+        float width = wrap ? content.width : 0.0f;
+        if (width != wrapWidth) {
+            wrapWidth = width;
+            lines.resetRows();
+            dropShapedLines();
+        }
+        topRow = std::min(topRow, rowsOf(topLine) - 1);
+
+        // no more lines than rows can be on screen
+        layoutCount++;
+        size_t viewEnd = topLine + (size_t)std::max(0.0f, std::ceil(content.height / rowHeight())) + 1;
+        visibleRows.clear();
+        float y = 0.0f;
+        for (size_t line = topLine; line < lines.lineCount() && y < content.height; line++) {
+            uint32_t slot = shapedLine(line, viewEnd);
+            ShapedLine& shaped = shapedLines[slot];
+            for (size_t row = line == topLine ? topRow : 0; row < shaped.rowCount() && y < content.height; row++) {
+                shapeRow(shaped, row);
+                visibleRows.push_back(VisibleRow{y, slot, (uint32_t)row});
+                y += rowHeight();
+            }
+        }
+    }
+
+    public:
+    TextArea() {
+        setHitTestable(true);
+        text.reset(ownedText);
+        lines.build(text);
+    }
+
+    // Shows the file without reading it all in, it has to stay the same while it is open
+    bool loadFile(const char* path) {
+        if (!file.open(path)) return false;
+        ownedText.clear();
+        text.reset(file.view());
+        lines.build(text);
+        dropShapedLines();
+        topLine = 0;
+        topRow = 0;
+        textChanged();
+        return true;
+    }
+
+    void setText(std::string newText) {
+        file.close();
+        ownedText = std::move(newText);
+        text.reset(ownedText);
+        lines.build(text);
+        dropShapedLines();
+        topLine = 0;
+        topRow = 0;
+        textChanged();
+    }
+
+    // Editing, offsets are in bytes
+    void insert(size_t offset, std::string_view newText) {
+        offset = std::min(offset, text.size());
+        size_t line = lines.lineAt(offset);
+        text.insert(offset, newText);
+        lines.edit(text, offset, 0, newText.size());
+        shapedLinesEdited(line, line, lines.lineAt(offset + newText.size()));
+        textChanged();
+    }
+
+    void erase(size_t offset, size_t length) {
+        if (offset >= text.size()) return;
+        length = std::min(length, text.size() - offset);
+        size_t first = lines.lineAt(offset);
+        size_t last = lines.lineAt(offset + length);
+        text.erase(offset, length);
+        lines.edit(text, offset, length, 0);
+        shapedLinesEdited(first, last, first);
+        textChanged();
+    }
+
+    size_t getSize() const {return text.size();}
+    size_t getLineCount() const {return lines.lineCount();}
+    size_t getPieceCount() const {return text.getPieceCount();}
+    size_t getLineStart(size_t line) const {return lines.lineStart(std::min(line, lines.lineCount() - 1));}
+    // wrapped rows of a line at the current width
+    size_t getLineRows(size_t line) {return rowsOf(std::min(line, lines.lineCount() - 1));}
+    std::string getLine(size_t line) {
+        readLine(std::min(line, lines.lineCount() - 1));
+        return lineText;
+    }
+    std::string getText(size_t offset, size_t length) const {
+        std::string out;
+        text.copy(offset, std::min(length, text.size() - std::min(offset, text.size())), out);
+        return out;
+    }
+
+    // Scrolling goes by wrapped rows, only the lines passed on the way are wrapped
+    void scrollBy(long rows) {
+        size_t row = topRow;
+        while (rows < 0) {
+            if (row > 0) {
+                long step = std::min<long>(-rows, (long)row);
+                row -= step;
+                rows += step;
+            }
+            else if (topLine > 0) {
+                topLine--;
+                row = rowsOf(topLine);
+            }
+            else break;
+        }
+        while (rows > 0) {
+            size_t left = rowsOf(topLine) - 1 - row;
+            if ((size_t)rows <= left) {
+                row += rows;
+                rows = 0;
+            }
+            else if (topLine + 1 < lines.lineCount()) {
+                rows -= left + 1;
+                topLine++;
+                row = 0;
+            }
+            else {
+                row += left;
+                break;
+            }
+        }
+        topRow = row;
+        markLayoutDirty();
+        damageSelf();
+    }
+
+    void scrollToLine(size_t line) {
+        topLine = std::min(line, lines.lineCount() - 1);
+        topRow = 0;
+        markLayoutDirty();
+        damageSelf();
+    }
+    size_t getTopLine() const {return topLine;}
+
+    bool onPointerWheel(float amount) override {
+        scrollBy((long)std::lround(-amount * wheelRows));
+        return true;
+    }
+
+    void setWrap(bool enable) {
+        if (wrap == enable) return;
+        wrap = enable;
+        wrapWidth = -1.0f;
+        topRow = 0;
+        markLayoutDirty();
+        damageSelf();
+    }
+
+    void setFontSize(int newFontSize) {
+        if (fontSize == newFontSize) return;
+        fontSize = newFontSize;
+        wrapWidth = -1.0f;
+        markLayoutDirty();
+        damageSelf();
+    }
+
+    void setTextColor(Color newColor) {
+        if (sameColor(textColor, newColor)) return;
+        textColor = newColor;
+        damageSelf();
+    }
+
+    void Draw(DrawList& list) override {
+        if (!visible) {return;}
+        Panel::Draw(list);
+
+        Rectangle content = getContentRect();
+        list.pushClip(content);
+        for (const VisibleRow& row : visibleRows)
+            list.text(font.texture, shapedLines[row.slot].rows[row.row], Vector2{(float)(int)content.x, (float)(int)(content.y + row.y)}, textColor);
+        list.popClip();
+
+        // scrollbar thumb, by lines since the rows of most lines are not known
+        size_t count = lines.lineCount();
+        if (count > 1 && content.height > 0) {
+            float thumbH = std::max(16.0f, content.height * std::min(1.0f, (float)visibleRows.size() / count));
+            float thumbY = content.y + (float)topLine / (count - 1) * (content.height - thumbH);
+            list.rect(Rectangle{content.x + content.width - 6, thumbY, 4, thumbH}, scrollbarColor);
+        }
+    }
+};
+
+
+// ========================================================
+// UI files
+//
+// A control tree saved as flat records, so a screen loads by mapping the
+// file and walking the records once. The file is:
+//   UiFileHeader, Style[styleCount], UiFileNode[nodeCount], text bytes
+// nodes are in tree order (a node, then its children), numbers are in the
+// byte order of the machine that wrote it, the header tells if it matches
+
+enum class UiNodeType : uint8_t {Label, Panel, Button, FlexPanel, StackPanel, Count};
+
+struct UiFileHeader {
+    char magic[4];      // "GUIB"
+    uint32_t byteOrder; // uiFileByteOrder as written
+    uint32_t version;
+    uint32_t styleCount;
+    uint32_t nodeCount;
+    uint32_t textBytes;
+};
+
+struct UiFileNode {
+    UiNodeType type;
+    uint8_t flags;          // UiNodeFlag bits
+    uint8_t styleOverrides; // Panel::OverrideField bits
+    uint8_t flex;           // direction, justify << 1, align << 3
+    uint32_t childCount;
+    int32_t x, y;
+    float width, height;    // preferred size
+    Edges padding, margin;
+    float flexGrow, flexShrink, gap;
+    uint32_t style;         // index into the styles, holds the overridden fields
+    uint32_t textOffset, textLength;
+    int32_t fontSize;
+    Color textColor;
+};
+
+enum UiNodeFlag : uint8_t {UiVisible = 1, UiEnabled = 2, UiHitTestable = 4, UiClipChildren = 8};
+
+inline constexpr uint32_t uiFileByteOrder = 0x01020304;
+inline constexpr uint32_t uiFileVersion = 1;
+
+static_assert(std::is_trivially_copyable<UiFileNode>::value && std::is_trivially_copyable<Style>::value,
+              "ui file records are copied as they are");
+static_assert(sizeof(UiFileHeader) % 4 == 0 && sizeof(Style) % 4 == 0 && sizeof(UiFileNode) % 4 == 0,
+              "ui file records have to stay 4 byte aligned in the file");
+
+// Writes a tree into a ui file, controls of other types (like ListView) are left out
+class UiFileWriter {
+    private:
+    StyleTable styles; // of this file, an id is the index in the file
+    std::vector<UiFileNode> nodes;
+    std::string text;
+
+    static bool typeOf(const Control& control, UiNodeType& type) {
+        const std::type_info& t = typeid(control);
+        if (t == typeid(Label)) type = UiNodeType::Label;
+        else if (t == typeid(Panel)) type = UiNodeType::Panel;
+        else if (t == typeid(Button)) type = UiNodeType::Button;
+        else if (t == typeid(FlexPanel)) type = UiNodeType::FlexPanel;
+        else if (t == typeid(StackPanel)) type = UiNodeType::StackPanel;
+        else return false;
+        return true;
+    }
+
+    uint32_t addStyle(const Style& style) {return styles.intern(style);}
+
+    void addText(UiFileNode& node, std::string_view s) {
+        node.textOffset = (uint32_t)text.size();
+        node.textLength = (uint32_t)s.size();
+        text.append(s);
+    }
+
+    void addPanel(UiFileNode& node, Panel& panel) {
+        Vector2 preferred = panel.getPreferredSize();
+        node.width = preferred.x;
+        node.height = preferred.y;
+        node.padding = panel.getPadding();
+        node.margin = panel.getMargin();
+        if (panel.getClipChildren()) node.flags |= UiClipChildren;
+        node.styleOverrides = panel.getStyleOverrides();
+        if (node.styleOverrides) node.style = addStyle(panel.getOverrideStyle());
+    }
+
+    // false when the control was left out
+    bool add(Control& control) {
+        UiFileNode node = UiFileNode{};
+        if (!typeOf(control, node.type)) {
+            TraceLog(LOG_WARNING, "UI: Skipped a control that can not be saved (%s)", typeid(control).name());
+            return false;
+        }
+        Vector2 pos = control.getPosition();
+        node.x = (int32_t)pos.x;
+        node.y = (int32_t)pos.y;
+        node.flags = (control.isVisible() ? UiVisible : 0) | (control.isEnabled() ? UiEnabled : 0) |
+                     (control.isHitTestable() ? UiHitTestable : 0);
+        node.flexGrow = control.getFlexGrow();
+        node.flexShrink = control.getFlexShrink();
+
+        Control* skip = nullptr; // made by the control itself
+        if (node.type == UiNodeType::Label) {
+            Label& label = static_cast<Label&>(control);
+            addText(node, label.getText());
+            node.fontSize = label.getFontSize();
+            node.textColor = label.getTextColor();
+        }
+        else {
+            addPanel(node, static_cast<Panel&>(control));
+            if (node.type == UiNodeType::Button) {
+                Button& button = static_cast<Button&>(control);
+                addText(node, button.getText());
+                node.fontSize = button.getFontSize();
+                node.textColor = button.getTextColor();
+                skip = const_cast<Label*>(button.getLabel());
+            }
+            else if (node.type == UiNodeType::FlexPanel || node.type == UiNodeType::StackPanel) {
+                FlexPanel& flex = static_cast<FlexPanel&>(control);
+                node.flex = (uint8_t)((uint8_t)flex.getDirection() | ((uint8_t)flex.getJustify() << 1) |
+                                      ((uint8_t)flex.getAlign() << 3));
+                node.gap = flex.getGap();
+            }
+        }
+
+        size_t index = nodes.size();
+        nodes.push_back(node);
+        uint32_t children = 0;
+        for (Control* child = control.getFirstChild(); child; child = child->getNextSibling()) {
+            if (child != skip && add(*child)) children++;
+        }
+        nodes[index].childCount = children;
+        return true;
+    }
+
+    public:
+    // Appends the file to out, false when the root can not be saved
+    bool write(Control& root, std::string& out) {
+        styles.clear();
+        nodes.clear();
+        text.clear();
+        if (!add(root)) return false;
+
+        UiFileHeader header = UiFileHeader{{'G', 'U', 'I', 'B'}, uiFileByteOrder, uiFileVersion,
+                                           (uint32_t)styles.size(), (uint32_t)nodes.size(), (uint32_t)text.size()};
+        out.append((const char*)&header, sizeof(header));
+        out.append((const char*)styles.data(), styles.size() * sizeof(Style));
+        out.append((const char*)nodes.data(), nodes.size() * sizeof(UiFileNode));
+        out.append(text);
+        return true;
+    }
+
+    bool save(Control& root, const char* path) {
+        std::string data;
+        if (!write(root, data)) return false;
+        if (!SaveFileData(path, data.data(), (int)data.size())) return false;
+        return true;
+    }
+};
+
+// Builds the tree in a ui file, nullptr when the file is not a valid one
+// nothing is parsed, labels and buttons loaded with load() show their text
+// where it is in the mapped file, which stays mapped while one of them does
+class UiFileReader {
+    private:
+    template <typename T, typename... Args>
+    static std::unique_ptr<T, ControlDeleter> make(ControlPool* pool, Args&&... args) {
+        if (pool) return pool->create<T>(std::forward<Args>(args)...);
+        return std::unique_ptr<T, ControlDeleter>(new T(std::forward<Args>(args)...));
+    }
+
+    static bool fail(const char* what) {
+        TraceLog(LOG_WARNING, "UI: Invalid ui file, %s", what);
+        return false;
+    }
+
+    const UiFileHeader* header = nullptr;
+    const Style* fileStyles = nullptr;
+    const UiFileNode* nodes = nullptr;
+    const char* text = nullptr;
+    std::shared_ptr<const void> textOwner; // keeps text alive, when the controls point into it
+
+    // Checks everything the loader reads, so loading itself can not fail
+    bool check(std::string_view data) {
+        if (data.size() < sizeof(UiFileHeader)) return fail("too short");
+        if (((uintptr_t)data.data() & 3) != 0) return fail("data has to be 4 byte aligned");
+        header = (const UiFileHeader*)data.data();
+        if (std::memcmp(header->magic, "GUIB", 4) != 0) return fail("wrong magic");
+        if (header->byteOrder != uiFileByteOrder) return fail("written on a machine with another byte order");
+        if (header->version != uiFileVersion) return fail("unknown version");
+        if (header->nodeCount == 0) return fail("no controls");
+
+        uint64_t need = sizeof(UiFileHeader) + (uint64_t)header->styleCount * sizeof(Style) +
+                        (uint64_t)header->nodeCount * sizeof(UiFileNode) + header->textBytes;
+        if (need != data.size()) return fail("wrong size");
+        fileStyles = (const Style*)(data.data() + sizeof(UiFileHeader));
+        nodes = (const UiFileNode*)(fileStyles + header->styleCount);
+        text = (const char*)(nodes + header->nodeCount);
+
+        // children have to add up to the node count, like a tree in tree order does
+        uint64_t open = 1;
+        for (uint32_t i = 0; i < header->nodeCount; i++) {
+            const UiFileNode& node = nodes[i];
+            if (open == 0) return fail("more nodes than the tree has");
+            open += node.childCount;
+            open--;
+            if (node.type >= UiNodeType::Count) return fail("unknown control type");
+            if ((uint64_t)node.textOffset + node.textLength > header->textBytes) return fail("text out of range");
+            if (node.styleOverrides && node.style >= header->styleCount) return fail("style out of range");
+            if (node.type == UiNodeType::Label && node.childCount > 0) return fail("labels have no children");
+            if (!(node.width >= 0 && node.width <= 1e6f && node.height >= 0 && node.height <= 1e6f))
+                return fail("size out of range");
+            if ((node.flex & 1) > (uint8_t)FlexDirection::Column || ((node.flex >> 1) & 3) > (uint8_t)FlexJustify::SpaceBetween ||
+                ((node.flex >> 3) & 3) > (uint8_t)FlexAlign::Stretch) return fail("unknown flex setting");
+        }
+        if (open != 0) return fail("missing nodes");
+        return true;
+    }
+
+    std::string_view textOf(const UiFileNode& node) const {
+        return std::string_view(text + node.textOffset, node.textLength);
+    }
+
+    // what a control is made with, empty when it is going to point into the file
+    std::string copiedText(const UiFileNode& node) const {
+        return textOwner ? std::string() : std::string(textOf(node));
+    }
+
+    void applyPanel(Panel& panel, const UiFileNode& node) {
+        panel.setSize((int)node.width, (int)node.height);
+        panel.setPadding(node.padding);
+        panel.setMargin(node.margin);
+        panel.setClipChildren(node.flags & UiClipChildren);
+        if (node.styleOverrides) panel.setStyleOverrides(node.styleOverrides, fileStyles[node.style]);
+    }
+
+    ControlPtr create(const UiFileNode& node, ControlPool* pool) {
+        ControlPtr control;
+        switch (node.type) {
+        case UiNodeType::Label: {
+            auto label = make<Label>(pool, copiedText(node), node.fontSize);
+            if (textOwner) label -> setTextInPlace(textOf(node), textOwner);
+            label -> setTextColor(node.textColor);
+            control = std::move(label);
+            break;
+        }
+        case UiNodeType::Panel: {
+            auto panel = make<Panel>(pool);
+            applyPanel(*panel, node);
+            control = std::move(panel);
+            break;
+        }
+        case UiNodeType::Button: {
+            auto button = make<Button>(pool, copiedText(node));
+            if (textOwner) button -> setTextInPlace(textOf(node), textOwner);
+            applyPanel(*button, node);
+            button -> setFontSize(node.fontSize);
+            button -> setTextColor(node.textColor);
+            control = std::move(button);
+            break;
+        }
+        case UiNodeType::FlexPanel:
+        case UiNodeType::StackPanel: {
+            auto flex = node.type == UiNodeType::FlexPanel ? make<FlexPanel>(pool) : make<StackPanel>(pool);
+            applyPanel(*flex, node);
+            flex -> setDirection((FlexDirection)(node.flex & 1));
+            flex -> setJustify((FlexJustify)((node.flex >> 1) & 3));
+            flex -> setAlign((FlexAlign)((node.flex >> 3) & 3));
+            flex -> setGap(node.gap);
+            control = std::move(flex);
+            break;
+        }
+        default: break;
+        }
+        control -> setPosition(node.x, node.y);
+        control -> setVisibility(node.flags & UiVisible);
+        control -> setEnabled(node.flags & UiEnabled);
+        control -> setHitTestable(node.flags & UiHitTestable);
+        control -> setFlexGrow(node.flexGrow);
+        control -> setFlexShrink(node.flexShrink);
+        return control;
+    }
+
+    public:
+    // without keepAlive data has to stay alive until this returns and the controls copy their text,
+    // with it they point into data and hold on to keepAlive
+    ControlPtr read(std::string_view data, ControlPool* pool = nullptr, std::shared_ptr<const void> keepAlive = nullptr) {
+        if (!check(data)) return nullptr;
+        textOwner = std::move(keepAlive);
+
+        // parents waiting for children, with how many are still to come
+        std::vector<std::pair<Control*, uint32_t>> open;
+        ControlPtr root = create(nodes[0], pool);
+        if (nodes[0].childCount > 0) open.emplace_back(root.get(), nodes[0].childCount);
+        for (uint32_t i = 1; i < header->nodeCount; i++) {
+            ControlPtr control = create(nodes[i], pool);
+            Control* added = control.get();
+            Control* parent = open.back().first;
+            if (--open.back().second == 0) open.pop_back();
+            parent -> addChild(std::move(control));
+            if (nodes[i].childCount > 0) open.emplace_back(added, nodes[i].childCount);
+        }
+        textOwner = nullptr;
+        return root;
+    }
+
+    // The file must not change while the tree is around
+    ControlPtr load(const char* path, ControlPool* pool = nullptr) {
+        auto file = std::make_shared<MappedFile>();
+        if (!file->open(path)) return nullptr;
+        std::string_view data = file->view();
+        return read(data, pool, std::move(file));
+    }
+};
+
+
+// ========================================================
+// Geometry store
+//
+// The geometry of a tree copied into flat arrays (structure of arrays), in
+// depth order so every parent comes before its children and the children of
+// one parent are next to each other. update() works out world positions,
+// outer and content rects and subtree bounds for the whole tree in a few
+// linear passes, 4 controls at a time where it can.
+// Opt in by setting UiContext::geometry, the controls tell the store what
+// changed and sync() only reads those again, drawChildren() then culls from
+// the arrays. Screen::render() and SoftwareBackend::render() sync it.
+// For big trees where walking the controls is the slow part (a million nodes)
+class GeometryStore {
+    private:
+    enum NodeFlag : uint8_t {Visible = 1, Clips = 2, Overflows = 4};
+
+    std::vector<Control*> controls;
+    std::vector<RectControl*> rects; // nullptr for controls without a rect
+    std::vector<uint32_t> childStart; // children of i are [childStart[i], childStart[i + 1])
+    std::vector<uint32_t> levels;     // where every depth starts, and the end
+
+    // input, local to the parent
+    std::vector<float> localX, localY;
+    std::vector<float> ownX, ownY, ownW, ownH;        // getLocalBounds()
+    std::vector<float> insetL, insetT, insetR, insetB; // padding and border
+    std::vector<uint8_t> flags;
+    Vector2 origin = Vector2{0, 0}; // world position of the root's parent
+
+    // output, in world space, bounds are min/max. An empty rect (no area) is
+    // kept as it is, rectUnion() skips those and rectsOverlap() can still hit them
+    std::vector<float> worldX, worldY;
+    std::vector<float> contentX, contentY, contentW, contentH;
+    std::vector<float> boundsX0, boundsY0, boundsX1, boundsY1;
+    std::vector<uint32_t> counts; // visible controls in the subtree, like Control::getSubtreeCount()
+
+    // what the controls reported since the last sync()
+    bool structureDirty = true;
+    bool updateNeeded = false;
+    std::vector<uint32_t> dirtyNodes;
+    std::vector<uint8_t> dirty;
+
+    struct CullEntry {
+        uint32_t index;
+        float x0, y0, x1, y1; // the clip it was culled against
+    };
+    std::vector<CullEntry> cullStack;
+
+    // scratch for build(), controls with their depth
+    std::vector<std::pair<Control*, uint32_t>> walk;
+    std::vector<std::pair<Control*, uint32_t>> walkStack;
+    std::vector<uint32_t> levelCursor;
+
+    template <typename... Vectors>
+    static void resizeAll(size_t count, Vectors&... vectors) {(vectors.resize(count), ...);}
+
+    // Reads one control again, the only place the store calls into controls
+    void pullNode(uint32_t i) {
+        Control* c = controls[i];
+        Vector2 pos = c->getPosition();
+        Rectangle own = c->getLocalBounds();
+        localX[i] = pos.x;
+        localY[i] = pos.y;
+        ownX[i] = own.x;
+        ownY[i] = own.y;
+        ownW[i] = own.width;
+        ownH[i] = own.height;
+        uint8_t f = c->isVisible() ? Visible : 0;
+        if (RectControl* r = rects[i]) {
+            Edges p = r->getPadding();
+            Edges b = r->getBorder();
+            insetL[i] = p.left + b.left;
+            insetT[i] = p.top + b.top;
+            insetR[i] = p.right + b.right;
+            insetB[i] = p.bottom + b.bottom;
+            if (r->getClipChildren()) f |= Clips;
+        }
+        else {
+            insetL[i] = insetT[i] = insetR[i] = insetB[i] = 0.0f;
+        }
+        flags[i] = f;
+    }
+
+    Vector2 rootOrigin() const {
+        Control* above = controls.empty() ? nullptr : controls[0]->getParent();
+        return above ? above->getWorldPosition() : Vector2{0, 0};
+    }
+
+    // world positions, every parent adds its position to its run of children
+    void worldPass() {
+        size_t count = controls.size();
+        worldX[0] = origin.x + localX[0];
+        worldY[0] = origin.y + localY[0];
+        for (size_t p = 0; p < count; p++) {
+            size_t c = childStart[p];
+            size_t end = childStart[p + 1];
+            if (c == end) continue;
+            float px = worldX[p], py = worldY[p];
+#if defined(__SSE2__)
+            const __m128 x = _mm_set1_ps(px);
+            const __m128 y = _mm_set1_ps(py);
+            for (; c + 4 <= end; c += 4) {
+                _mm_storeu_ps(&worldX[c], _mm_add_ps(x, _mm_loadu_ps(&localX[c])));
+                _mm_storeu_ps(&worldY[c], _mm_add_ps(y, _mm_loadu_ps(&localY[c])));
+            }
+#endif
+            for (; c < end; c++) {
+                worldX[c] = px + localX[c];
+                worldY[c] = py + localY[c];
+            }
+        }
+    }
+
+    // outer and content rects and own bounds, 4 controls at a time
+    void rectPass() {
+        size_t count = controls.size();
+        size_t i = 0;
+#if defined(__SSE2__)
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 4 <= count; i += 4) {
+            __m128 wx = _mm_loadu_ps(&worldX[i]);
+            __m128 wy = _mm_loadu_ps(&worldY[i]);
+            __m128 l = _mm_loadu_ps(&insetL[i]);
+            __m128 t = _mm_loadu_ps(&insetT[i]);
+            __m128 w = _mm_loadu_ps(&ownW[i]);
+            __m128 h = _mm_loadu_ps(&ownH[i]);
+            _mm_storeu_ps(&contentX[i], _mm_add_ps(wx, l));
+            _mm_storeu_ps(&contentY[i], _mm_add_ps(wy, t));
+            _mm_storeu_ps(&contentW[i], _mm_max_ps(zero, _mm_sub_ps(_mm_sub_ps(w, l), _mm_loadu_ps(&insetR[i]))));
+            _mm_storeu_ps(&contentH[i], _mm_max_ps(zero, _mm_sub_ps(_mm_sub_ps(h, t), _mm_loadu_ps(&insetB[i]))));
+
+            __m128 x0 = _mm_add_ps(wx, _mm_loadu_ps(&ownX[i]));
+            __m128 y0 = _mm_add_ps(wy, _mm_loadu_ps(&ownY[i]));
+            _mm_storeu_ps(&boundsX0[i], x0);
+            _mm_storeu_ps(&boundsY0[i], y0);
+            _mm_storeu_ps(&boundsX1[i], _mm_add_ps(x0, w));
+            _mm_storeu_ps(&boundsY1[i], _mm_add_ps(y0, h));
+        }
+#endif
+        for (; i < count; i++) {
+            contentX[i] = worldX[i] + insetL[i];
+            contentY[i] = worldY[i] + insetT[i];
+            contentW[i] = std::max(0.0f, ownW[i] - insetL[i] - insetR[i]);
+            contentH[i] = std::max(0.0f, ownH[i] - insetT[i] - insetB[i]);
+            boundsX0[i] = worldX[i] + ownX[i];
+            boundsY0[i] = worldY[i] + ownY[i];
+            boundsX1[i] = boundsX0[i] + ownW[i];
+            boundsY1[i] = boundsY0[i] + ownH[i];
+        }
+    }
+
+    // subtree bounds from the deepest nodes up, every node gathers its run of
+    // children (all done by then, they come after it) and clips them to its
+    // content rect. Works like getLocalSubtreeBounds(), empty rects included
+    void boundsPass() {
+        for (size_t i = controls.size(); i-- > 0;) {
+            float x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY; // of the children with an area
+            uint32_t count = 1;
+            size_t c = childStart[i];
+            size_t end = childStart[i + 1];
+#if defined(__SSE2__)
+            if (end - c >= 4) {
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i visibleBit = _mm_set1_epi32(Visible);
+                const __m128 empty0 = _mm_set1_ps(INFINITY);
+                const __m128 empty1 = _mm_set1_ps(-INFINITY);
+                __m128 vx0 = empty0, vy0 = empty0, vx1 = empty1, vy1 = empty1;
+                __m128i vcount = zero;
+                for (; c + 4 <= end; c += 4) {
+                    // 4 flag bytes to 4 lanes, hidden children are skipped
+                    int32_t packed;
+                    std::memcpy(&packed, &flags[c], 4);
+                    __m128i f = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+                    __m128i shownLanes = _mm_cmpeq_epi32(_mm_and_si128(f, visibleBit), visibleBit);
+                    vcount = _mm_add_epi32(vcount, _mm_and_si128(shownLanes, _mm_loadu_si128((const __m128i*)&counts[c])));
+
+                    // and so are the ones without an area, like rectUnion() does
+                    __m128 bx0 = _mm_loadu_ps(&boundsX0[c]), by0 = _mm_loadu_ps(&boundsY0[c]);
+                    __m128 bx1 = _mm_loadu_ps(&boundsX1[c]), by1 = _mm_loadu_ps(&boundsY1[c]);
+                    __m128 m = _mm_and_ps(_mm_castsi128_ps(shownLanes), _mm_and_ps(_mm_cmpgt_ps(bx1, bx0), _mm_cmpgt_ps(by1, by0)));
+                    vx0 = _mm_min_ps(vx0, _mm_or_ps(_mm_and_ps(m, bx0), _mm_andnot_ps(m, empty0)));
+                    vy0 = _mm_min_ps(vy0, _mm_or_ps(_mm_and_ps(m, by0), _mm_andnot_ps(m, empty0)));
+                    vx1 = _mm_max_ps(vx1, _mm_or_ps(_mm_and_ps(m, bx1), _mm_andnot_ps(m, empty1)));
+                    vy1 = _mm_max_ps(vy1, _mm_or_ps(_mm_and_ps(m, by1), _mm_andnot_ps(m, empty1)));
+                }
+                float lanes[4][4];
+                uint32_t countLanes[4];
+                _mm_storeu_ps(lanes[0], vx0);
+                _mm_storeu_ps(lanes[1], vy0);
+                _mm_storeu_ps(lanes[2], vx1);
+                _mm_storeu_ps(lanes[3], vy1);
+                _mm_storeu_si128((__m128i*)countLanes, vcount);
+                for (int k = 0; k < 4; k++) {
+                    x0 = std::min(x0, lanes[0][k]);
+                    y0 = std::min(y0, lanes[1][k]);
+                    x1 = std::max(x1, lanes[2][k]);
+                    y1 = std::max(y1, lanes[3][k]);
+                    count += countLanes[k];
+                }
+            }
+#endif
+            for (; c < end; c++) {
+                if (!(flags[c] & Visible)) continue;
+                count += counts[c];
+                if (!(boundsX1[c] > boundsX0[c] && boundsY1[c] > boundsY0[c])) continue;
+                x0 = std::min(x0, boundsX0[c]);
+                y0 = std::min(y0, boundsY0[c]);
+                x1 = std::max(x1, boundsX1[c]);
+                y1 = std::max(y1, boundsY1[c]);
+            }
+            counts[i] = count;
+
+            // no child with an area, rectUnion() then ends up with the last empty one,
+            // or the empty rect at this control without any children
+            bool innerEmpty = !(x1 > x0 && y1 > y0);
+            if (innerEmpty) {
+                x0 = x1 = worldX[i];
+                y0 = y1 = worldY[i];
+                for (size_t k = childStart[i + 1]; k-- > childStart[i];) {
+                    if (!(flags[k] & Visible)) continue;
+                    x0 = boundsX0[k];
+                    y0 = boundsY0[k];
+                    x1 = boundsX1[k];
+                    y1 = boundsY1[k];
+                    break;
+                }
+            }
+
+            flags[i] &= ~Overflows;
+            if ((flags[i] & Clips) && !innerEmpty) {
+                float cx0 = std::max(x0, contentX[i]);
+                float cy0 = std::max(y0, contentY[i]);
+                float cx1 = std::max(cx0, std::min(x1, contentX[i] + contentW[i]));
+                float cy1 = std::max(cy0, std::min(y1, contentY[i] + contentH[i]));
+                if (cx0 != x0 || cy0 != y0 || cx1 != x1 || cy1 != y1) flags[i] |= Overflows;
+                x0 = cx0;
+                y0 = cy0;
+                x1 = cx1;
+                y1 = cy1;
+                innerEmpty = !(x1 > x0 && y1 > y0);
+            }
+
+            // own rect and the children, an empty own rect gives way to the children even when they are empty
+            bool ownEmpty = !(boundsX1[i] > boundsX0[i] && boundsY1[i] > boundsY0[i]);
+            if (ownEmpty || !innerEmpty) {
+                if (!ownEmpty) {
+                    x0 = std::min(x0, boundsX0[i]);
+                    y0 = std::min(y0, boundsY0[i]);
+                    x1 = std::max(x1, boundsX1[i]);
+                    y1 = std::max(y1, boundsY1[i]);
+                }
+                boundsX0[i] = x0;
+                boundsY0[i] = y0;
+                boundsX1[i] = x1;
+                boundsY1[i] = y1;
+            }
+        }
+    }
+
+    public:
+    // Copies the shape of the tree and its geometry
+    void build(Control& root) {
+        // depth first, in the order the controls were most likely made in, a
+        // depth's controls come out in the same order breadth first has them
+        walk.clear();
+        levels.assign(2, 0);
+        walkStack.clear();
+        walkStack.emplace_back(&root, 0);
+        while (!walkStack.empty()) {
+            auto [control, depth] = walkStack.back();
+            walkStack.pop_back();
+            walk.emplace_back(control, depth);
+            if (levels.size() < depth + 2) levels.resize(depth + 2, 0);
+            levels[depth + 1]++;
+            for (Control* child = control->getLastChild(); child; child = child->getPrevSibling())
+                walkStack.emplace_back(child, depth + 1);
+        }
+        // depth starts, and the end
+        for (size_t d = 1; d < levels.size(); d++) levels[d] += levels[d - 1];
+
+        size_t count = walk.size();
+        controls.resize(count);
+        childStart.resize(count + 1);
+        resizeAll(count, rects, localX, localY, ownX, ownY, ownW, ownH, insetL, insetT, insetR, insetB, flags,
+                  worldX, worldY, contentX, contentY, contentW, contentH,
+                  boundsX0, boundsY0, boundsX1, boundsY1, counts);
+
+        // every control takes the next place of its depth, its children start
+        // where the next depth is at right then
+        levelCursor.assign(levels.begin(), levels.end());
+        for (const auto& [control, depth] : walk) {
+            uint32_t i = levelCursor[depth]++;
+            controls[i] = control;
+            childStart[i] = levelCursor[depth + 1];
+            control->geometryIndex = i;
+            rects[i] = control->asRectControl();
+            pullNode(i);
+        }
+        childStart[count] = (uint32_t)count;
+        origin = rootOrigin();
+
+        dirtyNodes.clear();
+        dirty.assign(count, 0);
+        structureDirty = false;
+        updateNeeded = true;
+    }
+
+    // Reads what the controls reported since the last sync and works the
+    // geometry out again, builds again after the tree changed shape
+    void sync(Control& root) {
+        if (structureDirty || controls.empty() || controls[0] != &root) build(root);
+        for (uint32_t i : dirtyNodes) {
+            pullNode(i);
+            dirty[i] = 0;
+        }
+        if (!dirtyNodes.empty()) updateNeeded = true;
+        dirtyNodes.clear();
+
+        Vector2 above = rootOrigin();
+        if (above.x != origin.x || above.y != origin.y) {
+            origin = above;
+            updateNeeded = true;
+        }
+        if (updateNeeded) update();
+    }
+
+    // Works everything out again from the local geometry
+    void update() {
+        updateNeeded = false;
+        if (controls.empty()) return;
+        worldPass();
+        rectPass();
+        boundsPass();
+    }
+
+    // Called by the controls
+    void markDirty(const Control& control) {
+        if (structureDirty || !contains(control)) return;
+        uint32_t i = control.geometryIndex;
+        if (dirty[i]) return;
+        dirty[i] = 1;
+        dirtyNodes.push_back(i);
+    }
+    void markStructureDirty() {structureDirty = true;}
+
+    // Nothing changed since the last sync(), the arrays can be used for drawing
+    bool isCurrent() const {return !structureDirty && !updateNeeded && dirtyNodes.empty();}
+
+    // Controls that would be drawn in view, in draw order, like drawChildren() culls them
+    // only goes into the subtrees that are in view
+    void cull(Rectangle view, std::vector<uint32_t>& out) {
+        out.clear();
+        if (controls.empty() || !(flags[0] & Visible)) return;
+
+        cullStack.clear();
+        cullStack.push_back(CullEntry{0, view.x, view.y, view.x + view.width, view.y + view.height});
+        while (!cullStack.empty()) {
+            CullEntry e = cullStack.back();
+            cullStack.pop_back();
+            uint32_t i = e.index;
+            out.push_back(i);
+            if (flags[i] & Overflows) {
+                e.x0 = std::max(e.x0, contentX[i]);
+                e.y0 = std::max(e.y0, contentY[i]);
+                e.x1 = std::min(e.x1, contentX[i] + contentW[i]);
+                e.y1 = std::min(e.y1, contentY[i] + contentH[i]);
+            }
+            // backwards, so the first child comes off the stack first
+            for (uint32_t c = childStart[i + 1]; c-- > childStart[i];) {
+                if (!(flags[c] & Visible)) continue;
+                if (!(boundsX0[c] < e.x1 && e.x0 < boundsX1[c] && boundsY0[c] < e.y1 && e.y0 < boundsY1[c])) continue;
+                cullStack.push_back(CullEntry{c, e.x0, e.y0, e.x1, e.y1});
+            }
+        }
+    }
+
+    // Moves a node in the store only, the control does not see it
+    void setLocalPosition(uint32_t i, float x, float y) {
+        localX[i] = x;
+        localY[i] = y;
+        updateNeeded = true;
+    }
+
+    size_t size() const {return controls.size();}
+    size_t getDepthCount() const {return levels.size() - 1;}
+    Control* getControl(uint32_t i) const {return controls[i];}
+    bool contains(const Control& control) const {
+        uint32_t i = control.geometryIndex;
+        return i < controls.size() && controls[i] == &control;
+    }
+    // size() when the control is not in the store
+    uint32_t indexOf(const Control& control) const {
+        return contains(control) ? control.geometryIndex : (uint32_t)controls.size();
+    }
+    uint32_t getFirstChild(uint32_t i) const {return childStart[i];}
+    uint32_t getChildEnd(uint32_t i) const {return childStart[i + 1];}
+
+    bool isVisible(uint32_t i) const {return flags[i] & Visible;}
+    // the children reach out of the content rect, drawChildren() clips them
+    bool childrenOverflow(uint32_t i) const {return flags[i] & Overflows;}
+    Vector2 getWorldPosition(uint32_t i) const {return Vector2{worldX[i], worldY[i]};}
+    Rectangle getOuterRect(uint32_t i) const {return Rectangle{worldX[i], worldY[i], ownW[i], ownH[i]};}
+    Rectangle getContentRect(uint32_t i) const {return Rectangle{contentX[i], contentY[i], contentW[i], contentH[i]};}
+    // the same as Control::getSubtreeBounds()
+    Rectangle getSubtreeBounds(uint32_t i) const {
+        if (!(flags[i] & Visible)) return Rectangle{0, 0, 0, 0};
+        return Rectangle{boundsX0[i], boundsY0[i], boundsX1[i] - boundsX0[i], boundsY1[i] - boundsY0[i]};
+    }
+    uint32_t getSubtreeCount(uint32_t i) const {return counts[i];}
+};
+
+inline void syncGeometry(Control& root) {
+    UiContext* ui = root.getContext();
+    if (ui && ui->geometry) ui->geometry->sync(root);
+}
+
+inline void Control::geometryChanged() {
+    if (context && context->geometry) context->geometry->markDirty(*this);
+}
+
+inline void Control::geometryStructureChanged() {
+    if (context && context->geometry) context->geometry->markStructureDirty();
+}
+
+// drawChildren() over the store's arrays, false when the store is behind the
+// controls and the pointer walk has to do it
+inline bool Control::drawChildrenFromStore(DrawList& list) {
+    const GeometryStore& geometry = *context->geometry;
+    if (!geometry.isCurrent() || !geometry.contains(*this)) return false;
+
+    uint32_t index = geometryIndex;
+    bool clipping = geometry.childrenOverflow(index);
+    if (clipping) list.pushClip(geometry.getContentRect(index));
+
+    Rectangle view = list.getClip();
+    for (uint32_t i = geometry.getFirstChild(index); i < geometry.getChildEnd(index); i++) {
+        if (!geometry.isVisible(i)) continue;
+        if (!rectsOverlap(geometry.getSubtreeBounds(i), view)) {
+            uiStats.culledNodes += geometry.getSubtreeCount(i);
+            continue;
+        }
+        Control* child = geometry.getControl(i);
+        uiStats.drawnNodes++;
+        GUI_PROFILE_CONTROL(DrawPhase, child);
+        child -> Draw(list);
+    }
+
+    if (clipping) list.popClip();
+    return true;
+}
@@ -1,402 +1,4 @@
-#include "raylib.h"
-#include "iostream"
-#include "memory"
-#include "vector"
-#include "string"
-#include <algorithm>
-#include <endian.h>
-#include <memory>
-#include <pthread.h>
-#include <string>
-#include <vector>
-
-
-// For borders , margins and stuff
-struct Edges {
-    float left, right, top, bottom;
-
-    static Edges All(float v) {
-        return Edges{v,v,v,v};
-    }
-
-    static Edges Symmatric(float horizontal, float vertical) {
-        return Edges{horizontal, horizontal, vertical, vertical};
-    }
-};
-
-// for style data on buttons
-struct Style {
-    Color bgColor;
-    Color borderColor;
-    Edges borderThickness;
-};
-
-// Base UI class 'Control'
-class Control {
-    protected:
-    Vector2 position = Vector2{0, 0};
-
-    bool visible = true;
-    bool enabled = true;
-
-    Control* parent = nullptr; // parent
-    std::vector<std::unique_ptr<Control>> children; // children
-
-    public:
-    virtual ~Control() = default;
-
-    // Add a control object as a child to this object
-    void addChild(std::unique_ptr<Control> child) {
-        if (!child) return;
-        child -> parent = this;
-        children.push_back(std::move(child));
-    }
-    // Rmove a child
-    // the 'i' may get out of range if not carefull
-    void removeChild(Control* child) {
-        for (auto i = children.begin(); i != children.end(); ++i) {
-            if (i->get() == child) {
-                (*i)->parent = nullptr;
-                children.erase(i); // DESTROYS child
-                return;
-            }
-        }
-    }
-
-    Control* getParent() const {return parent;}
-
-    virtual void setPosition(int x, int y) {
-            position = Vector2{(float)x, (float)y};
-    }
-
-    Vector2 getPosition() const {return position;}
-
-    Vector2 getWorldPosition() {
-        if (parent) {
-            Vector2 parentPos = parent -> getWorldPosition();
-            return Vector2{parentPos.x + position.x, parentPos.y + position.y};
-        }
-        else {
-            return position;
-        }
-    }
-
-    void setVisibility(bool visibility) {visible = visibility;}
-    bool isVisible() const {return visible;}
-
-    virtual void Update() {
-        for (auto& child : children)
-            child -> Update();
-    }
-    virtual void Draw() {
-        if (!visible) {return;}
-        for (auto& child : children)
-            child -> Draw();
-    }
-};
-// for base classes with size (width and height)
-class RectControl : public Control{
-    protected:
-    Vector2 size = Vector2{0, 0};
-
-    // Layout stuff
-    Edges padding;
-    Edges border;
-    Edges margin;
-
-    public:
-    void setSize(int width, int height) {
-        size = Vector2{(float)width, (float)height};
-    }
-
-    Vector2 getSize() const {return size;}
-
-    // padding
-    void setPadding(const Edges& paddingEdges) {padding = paddingEdges;}
-    void setPadding(float all) {padding = Edges::All(all);}
-    void setPadding(float horizontal, float vertical) {padding = Edges::Symmatric(horizontal, vertical);}
-    Edges getPadding() {return padding;}
-
-    //border
-    void setBorderThickness(const Edges& borderEdges) {border = borderEdges;}
-    void setBorderThickness(float all) {border = Edges::All(all);}
-    void setBorderThickness(float horizontal, float vertical) {border = Edges::Symmatric(horizontal, vertical);}
-    Edges getBorder() {return border;}
-
-    //margin
-    void setMargin(const Edges& marginEdges) {margin = marginEdges;}
-    void setMargin(float all) {margin = Edges::All(all);}
-    Edges getMargin() {return margin;}
-
-    // The actual rect
-    Rectangle getOuterRect() {
-        Vector2 wp = getWorldPosition();
-        return {wp.x, wp.y, size.x, size.y};
-    }
-
-    // for layout stuff
-    Rectangle getLayoutRect() {
-        Rectangle r = getOuterRect();
-        return {
-            r.x - margin.left,
-            r.y - margin.top,
-            r.width + margin.left + margin.right,
-            r.height + margin.top + margin.bottom
-        };
-    }
-
-    Rectangle getContentRect() {
-        Rectangle r = getOuterRect();
-        float contentW = r.width  - (padding.left + padding.right) - (border.left + border.right);
-        float contentH = r.height - (padding.top  + padding.bottom) - (border.top  + border.bottom);
-        // Avoid negative values
-        contentW = std::max(0.0f, contentW);
-        contentH = std::max(0.0f, contentH);
-
-        return {
-            r.x + padding.left + border.left,
-            r.y + padding.top + border.top,
-            contentW,
-            contentH
-        };
-    }
-};
-
-// Display Text inside the window
-class Label : public Control{
-    private:
-    std::string text = "";
-    Font font = GetFontDefault();
-    float spacing = 1.0f;
-    int fontSize = 16;
-    int textSize = 0;
-    Color color = BLACK;
-
-    public:
-
-    explicit Label(const std::string newText, int newFontSize)
-    : text(newText), fontSize(newFontSize){
-        textSize = MeasureText(text.c_str(), fontSize);
-    }
-
-    void setText(const std::string& newText) {
-        text = newText;
-        textSize = MeasureText(text.c_str(), fontSize);
-    }
-
-    std::string getText() const {return text;}
-
-    void setFontSize(int newFontSize) {
-        fontSize = newFontSize;
-    }
-    int getFontSize() const {return fontSize;}
-
-    int getTextSize() const {return textSize;}
-
-    Vector2 getTextBounds() const {
-        return MeasureTextEx(font, text.c_str(), fontSize, spacing);
-    }
-
-
-    void setPosition(int x, int y) override {
-        Control::setPosition(x, y);
-    }
-
-    void setTextColor(Color newColor) {
-        color = newColor;
-    }
-
-    Color getTextColor() {return color;}
-
-    void Draw() override{
-        if (!visible) {return;}
-
-        DrawText(text.c_str(), getWorldPosition().x, getWorldPosition().y, fontSize, color);
-        Control::Draw();
-    }
-};
-
-// To get them label text related functions
-class TextElement {
-protected:
-    Label* label = nullptr;
-    virtual void onTextChanged() {}
-
-public:
-    void setText(const std::string& newText) {
-        if (label) {label -> setText(newText);}
-        onTextChanged();
-    }
-
-    std::string getText() {
-        return label ? label -> getText() : "";
-    }
-
-    void setFontSize(int newFontSize) {
-        if (label) {label -> setFontSize(newFontSize);}
-    }
-
-    int getFontSize() {
-        return label ? label -> getFontSize() : 0;
-    }
-
-    int getTextSize() {
-        return label ? label -> getTextSize() : 0;
-    }
-
-    void setTextColor(Color newColor) {
-        if (label) {label -> setTextColor(newColor);}
-    }
-
-    Color getTextColor() {
-        return label ? label -> getTextColor() : BLACK;// return black if no color is set
-    }
-};
-
-
-// Used as a Background to hold Ui elements
-class Panel : public RectControl{
-    private:
-    Color color = WHITE;
-    Color borderColor = WHITE;
-
-    public:
-
-    void setColor(Color newColor) {
-        color = newColor;
-    }
-
-    Color getColor() {return color;}
-
-    void setBorderColor(Color newColor) {
-        borderColor = newColor;
-    }
-
-    Color getBorderColor() {return borderColor;}
-
-    void Draw() override {
-        Rectangle outer = getOuterRect();
-        // Rectangle content = getContentRect();
-
-        // background ONLY
-        DrawRectangleRec(outer, color);
-
-        // border inside outer rect
-        Edges b = getBorder();
-
-        if (b.left > 0)
-            DrawRectangle(outer.x, outer.y, b.left, outer.height, borderColor);
-        if (b.right > 0)
-            DrawRectangle(outer.x + outer.width - b.right, outer.y, b.right, outer.height, borderColor);
-        if (b.top > 0)
-            DrawRectangle(outer.x, outer.y, outer.width, b.top, borderColor);
-        if (b.bottom > 0)
-            DrawRectangle(outer.x, outer.y + outer.height - b.bottom, outer.width, b.bottom, borderColor);
-
-        Control::Draw();
-    }
-
-};
-
-// A button to press
-class Button : public Panel, public TextElement{
-private:
-    // Default styles
-    Style normalStyle = { GRAY, DARKGRAY, Edges::All(2) };
-    Style hoverStyle  = { LIGHTGRAY, BLACK, Edges::All(2) };
-    Style pressStyle  = { DARKGRAY, BLACK, Edges::All(4) };
-
-    Style* currentStyle = &normalStyle;
-
-    // States
-    bool hovered = false;
-    bool pressed = false;
-
-    void applyStyle() {
-        setColor(currentStyle -> bgColor);
-        setBorderColor(currentStyle -> borderColor);
-        setBorderThickness(currentStyle -> borderThickness);
-        reCalcLayout();
-    }
-
-public:
-    Button(const std::string& text) {
-
-        setPadding(Edges::All(6));
-
-        auto lbl = std::make_unique<Label>(text, 16);
-        label = lbl.get();
-        addChild(std::move(lbl));
-
-        reCalcLayout();
-    }
-
-    void onTextChanged() override{
-        reCalcLayout();
-    }
-
-    void reCalcLayout() {
-        Vector2 textDim = label->getTextBounds();
-
-        // Avoid negative values
-        float minW = 30;
-        float minH = 30;
-
-        float w = std::max(minW, textDim.x + getPadding().left + getPadding().right + getBorder().left + getBorder().right);
-        float h = std::max(minH, textDim.y + getPadding().top  + getPadding().bottom + getBorder().top  + getBorder().bottom);
-
-        setSize(w, h);
-
-        // Use LOCAL coordinates
-        float localContentX = getPadding().left + getBorder().left;
-        float localContentY = getPadding().top  + getBorder().top;
-        float localContentW = w - (getPadding().left + getPadding().right) - (getBorder().left + getBorder().right);
-        float localContentH = h - (getPadding().top  + getPadding().bottom) - (getBorder().top  + getBorder().bottom);
-
-        // Centering text
-        float x = localContentX + (localContentW - textDim.x) / 2.0f;
-        float y = localContentY + (localContentH - textDim.y) / 2.0f;
-
-        label->setPosition((int)x, (int)y);
-    }
-
-
-    void Update() override {
-        Vector2 mouse = GetMousePosition();
-        Rectangle r = getOuterRect();
-
-        hovered = CheckCollisionPointRec(mouse, r);
-
-        if (hovered && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
-            pressed = true;
-        }
-        if (pressed && IsMouseButtonReleased(MOUSE_LEFT_BUTTON)) {
-            pressed = false;
-        }
-        if (hovered) {
-            if (pressed) {
-                currentStyle = &pressStyle;
-                applyStyle();
-            }
-            else {
-                currentStyle = &hoverStyle;
-                applyStyle();
-            }
-        }
-        else {
-            currentStyle = &normalStyle;
-            applyStyle();
-        }
-
-        Control::Update();
-    }
-
-    void Draw() override {
-        Panel::Draw();
-    }
-
-};
-
+#include "guilib.hpp"
 
 // The Mainstuff
 int main(void) {
@@ -406,6 +8,14 @@ int main(void) {
     InitWindow(windowWidth, windowHeight, "My GUI Library");
     SetTargetFPS(60);
 
+    // block on input when nothing changed instead of redrawing at 60 FPS
+    bool eventDriven = true;
+
+    // has to outlive the controls
+    InputDispatcher input(Rectangle{0, 0, (float)windowWidth, (float)windowHeight});
+    UiContext ui;
+    ui.input = &input;
+
     // ========================================================
     // Testin stuff
     //
@@ -432,6 +42,19 @@ int main(void) {
     testPanel -> addChild(std::move(testBtn));
     testBtn = nullptr;
 
+    // A row of buttons laid out by a StackPanel
+    auto buttonRow = std::make_unique<StackPanel>(FlexDirection::Row, 8);
+    buttonRow -> setPosition(40, 320);
+    buttonRow -> setPadding(6);
+    buttonRow -> setColor(LIGHTGRAY);
+    buttonRow -> setAlign(FlexAlign::Center);
+    for (const char* text : {"One", "Two", "Three"}) {
+        auto rowBtn = std::make_unique<Button>(text);
+        rowBtn -> setMargin(2);
+        buttonRow -> addChild(std::move(rowBtn));
+    }
+    testPanel -> addChild(std::move(buttonRow));
+
     // ========================================================
     // Title Label
     auto titleLbl = std::make_unique<Label>("My GUI Library!", 20);
@@ -440,19 +63,65 @@ int main(void) {
     testPanel -> addChild(std::move(titleLbl));
     titleLbl = nullptr;
 
+    // measures the text of the whole tree at once before setContext() needs it
+    ThreadPool pool;
+    testPanel -> prepareLayout(&pool);
+    testPanel -> setContext(&ui);
+
+    // T switches between the default look and this one
+    Theme darkTheme;
+    darkTheme.set(StyleRole::Button, Style{ DARKGRAY, BLACK, Edges::All(2) });
+    darkTheme.set(StyleRole::ButtonHover, Style{ GRAY, ORANGE, Edges::All(2) });
+    darkTheme.set(StyleRole::ButtonPressed, Style{ BLACK, ORANGE, Edges::All(4) });
+
+    RaylibBackend backend;
+    // the render texture has to go before the window does
+    auto screen = std::make_unique<Screen>(windowWidth, windowHeight, BLACK);
+
     while(!WindowShouldClose()) {
+        uiStats.reset();
 
-        testPanel -> Update();
+        if (IsKeyPressed(KEY_T)) setTheme(currentTheme == &darkTheme ? nullptr : &darkTheme);
+
+        {
+            GUI_PROFILE_PHASE("Update", UpdatePhase);
+            input.update();
+            testPanel -> Update();
+        }
+        {
+            GUI_PROFILE_PHASE("Layout", LayoutPhase);
+            // labels whose text changed in Update() get measured here, on the pool
+            testPanel -> prepareLayout(&pool);
+            testPanel -> Layout();
+        }
+
+        bool repainted;
+        {
+            GUI_PROFILE_PHASE("Draw", DrawPhase);
+            repainted = screen -> render(*testPanel, ui, backend);
+        }
 
         BeginDrawing();
-        
-        ClearBackground(BLACK);
 
-        testPanel -> Draw();
+        screen -> present();
+        GUI_PROFILE_OVERLAY(4, 4);
         
         EndDrawing();
+        GUI_PROFILE_END_FRAME();
+
+#ifdef GUILIB_PROFILE
+        // F9 saves what was recorded so far for chrome://tracing
+        if (IsKeyPressed(KEY_F9)) Profiler::shared().writeChromeTrace("guilib_trace.json");
+#endif
+
+        if (eventDriven) {
+            if (repainted) DisableEventWaiting();
+            else EnableEventWaiting();
+        }
     }
 
+    screen = nullptr;
+    setTheme(nullptr);
     CloseWindow();
 
     return 0;